@@ -50,6 +50,8 @@ function PairingDialog({ open, onClose }) {
     if (open) {
       let intervalId;
       let timeoutId;
+      // Mode restored after pairing, e.g. the auto-connect mode.
+      let reconnectScanMode = scanModePairedDeviceOnly;
 
       const setScanMode = async (mode) => {
         try {
@@ -66,16 +68,29 @@ function PairingDialog({ open, onClose }) {
             setPairedDevice(response.data.lastConnectedDevice);
             clearInterval(intervalId);
             clearTimeout(timeoutId);
-            setScanMode(scanModePairedDeviceOnly);
+            setScanMode(reconnectScanMode);
           }
         } catch (error) {
           console.error("Error fetching last connected device:", error);
         }
       };
 
+      const startPairing = async () => {
+        try {
+          const response = await axios.get("/api/scan-mode");
+          // A pairing mode left by a dialog which is still closing is not restored.
+          if (response.data.scanMode >= scanModePairedDeviceOnly) {
+            reconnectScanMode = response.data.scanMode;
+          }
+        } catch (error) {
+          console.error("Error fetching scan mode:", error);
+        }
+        setScanMode(scanModeNewDeviceOnly);
+      };
+
       setPairedDevice(null);
       setNotFound(false);
-      setScanMode(scanModeNewDeviceOnly);
+      startPairing();
 
       intervalId = setInterval(() => {
         checkLastConnectedDevice();
@@ -87,14 +102,14 @@ function PairingDialog({ open, onClose }) {
       timeoutId = setTimeout(() => {
         if (pairedDevice) return;
         clearInterval(intervalId);
-        setScanMode(scanModePairedDeviceOnly);
+        setScanMode(reconnectScanMode);
         setNotFound(true);
       }, timeout);
 
       return () => {
         clearInterval(intervalId);
         clearTimeout(timeoutId);
-        setScanMode(scanModePairedDeviceOnly);
+        setScanMode(reconnectScanMode);
         setProgress(0);
       };
     }
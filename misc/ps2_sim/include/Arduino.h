@@ -0,0 +1,31 @@
+#ifndef E5A1C7D2_3B84_4F6E_A1D9_7C2E48B5F013
+#define E5A1C7D2_3B84_4F6E_A1D9_7C2E48B5F013
+
+// Stand-in for the parts of the Arduino core and FreeRTOS that the firmware's PS/2 mouse sender uses, so that the simulator
+// runs the real Ps2MouseSender. Tasks and task notifications are implemented in sim_rtos.cpp on the simulated clock.
+
+#include <cstdint>
+#include <string>
+
+#define APP_CPU_NUM (1)
+#define PRO_CPU_NUM (0)
+
+#define pdTRUE (1)
+#define pdFALSE (0)
+#define pdPASS (1)
+#define pdFAIL (0)
+#define portMAX_DELAY (0xFFFFFFFFU)
+
+using BaseType_t = int;
+using UBaseType_t = unsigned int;
+using TickType_t = std::uint32_t;
+using TaskFunction_t = void (*)(void*);
+using TaskHandle_t = struct SimTask*;
+using QueueHandle_t = void*;
+
+BaseType_t xTaskCreateUniversal(TaskFunction_t taskFunction, const char* name, std::uint32_t stackDepth, void* parameter,
+                                UBaseType_t priority, TaskHandle_t* createdTask, BaseType_t core);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+std::uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+
+#endif /* E5A1C7D2_3B84_4F6E_A1D9_7C2E48B5F013 */
@@ -0,0 +1,35 @@
+#ifndef B7D40E19_8C26_4A3F_9E5B_2F61A0C8D4E7
+#define B7D40E19_8C26_4A3F_9E5B_2F61A0C8D4E7
+
+// Stand-in for ESP-IDF's esp_timer on the simulated clock, see sim_rtos.hpp.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK (0)
+#define ESP_FAIL (-1)
+#define ESP_ERR_INVALID_ARG (0x102)
+#define ESP_ERR_INVALID_STATE (0x103)
+
+typedef struct esp_timer* esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void* arg);
+
+typedef enum {
+  ESP_TIMER_TASK,
+} esp_timer_dispatch_t;
+
+typedef struct {
+  esp_timer_cb_t callback;
+  void* arg;
+  esp_timer_dispatch_t dispatch_method;
+  const char* name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+const char* esp_err_to_name(esp_err_t code);
+esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args, esp_timer_handle_t* out_handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+int64_t esp_timer_get_time(void);
+
+#endif /* B7D40E19_8C26_4A3F_9E5B_2F61A0C8D4E7 */
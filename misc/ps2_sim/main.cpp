@@ -0,0 +1,199 @@
+// PS/2 wire-protocol simulator. Drives a modelled mouse and keyboard link with the firmware's own mouse sender, running on a
+// simulated clock, and prints throughput, queueing delay and the impact of host inhibits. See misc/README.md for how to build
+// and run it.
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "link_phase.hpp"
+#include "mouse_sender.hpp"
+#include "ps2_wire_model.hpp"
+#include "sim_rtos.hpp"
+
+namespace {
+
+class ScenarioConfig {
+ public:
+  std::int64_t durationMillis = 10000;
+  std::uint8_t sampleRate = 100;
+  std::int64_t bleIntervalMicros = 7500;  // BLE mouse report interval
+  std::int32_t motionPerReport = 12;      // Counts moved per BLE report
+  std::int64_t keyIntervalMicros = 50000;
+  Ps2MouseType mouseType = Ps2MouseType::IntelliMouseExplorer;
+  Ps2WireConfig wire;
+};
+
+std::int64_t percentile(std::vector<std::int64_t> values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1, static_cast<std::size_t>(p * values.size()))];
+}
+
+std::int64_t mean(const std::vector<std::int64_t>& values) {
+  if (values.empty()) {
+    return 0;
+  }
+  return std::accumulate(values.begin(), values.end(), std::int64_t(0)) / static_cast<std::int64_t>(values.size());
+}
+
+void printStats(const std::string& name, const Ps2WireModel& wire, const ScenarioConfig& config) {
+  const auto durationMicros = config.durationMillis * 1000;
+  const auto& stats = wire.getStats();
+  const auto wireMicros = static_cast<std::int64_t>(stats.deliveredBytes + stats.hostCommandBytes) * 11 * 2 * config.wire.clockHalfPeriodMicros;
+  fmt::print("{}.bytes_per_second: {:.1f}\n", name, stats.deliveredBytes * 1e6 / durationMicros);
+  fmt::print("{}.wire_utilization_percent: {:.1f}\n", name, wireMicros * 100.0 / durationMicros);
+  fmt::print("{}.packets_delivered: {}\n", name, stats.deliveredPackets);
+  fmt::print("{}.packets_dropped: {}\n", name, stats.droppedPackets);
+  fmt::print("{}.queue_delay_us: mean {} p50 {} p99 {} max {}\n", name, mean(stats.queueDelayMicros),
+             percentile(stats.queueDelayMicros, 0.5), percentile(stats.queueDelayMicros, 0.99), percentile(stats.queueDelayMicros, 1.0));
+  fmt::print("{}.latency_us: mean {} p50 {} p99 {} max {}\n", name, mean(stats.latencyMicros), percentile(stats.latencyMicros, 0.5),
+             percentile(stats.latencyMicros, 0.99), percentile(stats.latencyMicros, 1.0));
+  fmt::print("{}.aborted_frames: {}\n", name, stats.abortedFrames);
+  fmt::print("{}.aborted_wire_us: {}\n", name, stats.abortedWireMicros);
+  fmt::print("{}.inhibited_wait_us: {}\n", name, stats.inhibitedWaitMicros);
+  fmt::print("{}.resent_bytes: {}\n", name, stats.resentBytes);
+  fmt::print("{}.host_command_latency_us: mean {} max {}\n", name, mean(stats.commandLatencyMicros),
+             percentile(stats.commandLatencyMicros, 1.0));
+  fmt::print("{}.host_reset_latency_us: mean {} max {}\n", name, mean(stats.resetLatencyMicros), percentile(stats.resetLatencyMicros, 1.0));
+}
+
+// Options are given as key=value, e.g. sample_rate=200 holdoff_us=300.
+bool parseArguments(int argc, char** argv, ScenarioConfig& config) {
+  std::map<std::string, std::int64_t*> intOptions = {
+      {"duration_ms", &config.durationMillis},
+      {"ble_interval_us", &config.bleIntervalMicros},
+      {"key_interval_us", &config.keyIntervalMicros},
+      {"clock_half_period_us", &config.wire.clockHalfPeriodMicros},
+      {"byte_interval_us", &config.wire.byteIntervalMicros},
+      {"holdoff_us", &config.wire.hostHoldoffMicros},
+      {"inhibit_interval_us", &config.wire.inhibitIntervalMicros},
+      {"inhibit_duration_us", &config.wire.inhibitDurationMicros},
+      {"command_response_us", &config.wire.commandResponseMicros},
+  };
+  for (int i = 1; i < argc; i++) {
+    std::string argument = argv[i];
+    auto separator = argument.find('=');
+    if (separator == std::string::npos) {
+      fmt::print(stderr, "Invalid argument: {}\n", argument);
+      return false;
+    }
+    auto key = argument.substr(0, separator);
+    auto value = argument.substr(separator + 1);
+    if (intOptions.count(key) != 0) {
+      *intOptions[key] = std::strtoll(value.c_str(), nullptr, 10);
+    } else if (key == "sample_rate") {
+      config.sampleRate = std::strtoul(value.c_str(), nullptr, 10);
+    } else if (key == "motion_per_report") {
+      config.motionPerReport = std::strtol(value.c_str(), nullptr, 10);
+    } else if (key == "parity_error_rate") {
+      config.wire.parityErrorRate = std::strtod(value.c_str(), nullptr);
+    } else if (key == "seed") {
+      config.wire.seed = std::strtoul(value.c_str(), nullptr, 10);
+    } else if (key == "mouse_type") {
+      config.mouseType = value == "generic"       ? Ps2MouseType::Generic
+                         : value == "intellimouse" ? Ps2MouseType::IntelliMouse
+                                                   : Ps2MouseType::IntelliMouseExplorer;
+    } else {
+      fmt::print(stderr, "Unknown option: {}\n", key);
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ScenarioConfig config;
+  if (!parseArguments(argc, argv, config)) {
+    return 1;
+  }
+
+  Ps2WireModel mouseWire(Ps2DeviceKind::Mouse, config.wire);
+  Ps2WireModel keyboardWire(Ps2DeviceKind::Keyboard, config.wire);
+  SimPs2Mouse mouse(mouseWire, config.mouseType);
+  SimPs2Keyboard keyboard(keyboardWire);
+
+  // Host start-up: reset, set the sample rate and enable data reporting, then set the keyboard LEDs.
+  mouseWire.sendHostCommand({0xFF});
+  mouseWire.sendHostCommand({0xF3, config.sampleRate});
+  mouseWire.sendHostCommand({0xF4});
+  keyboardWire.sendHostCommand({0xFF});
+  keyboardWire.sendHostCommand({0xED, 0x02});
+
+  // Input starts once both devices are configured, the same as a user who starts after boot.
+  std::int64_t startMicros = 0;
+  while (!mouseWire.isIdle() || !keyboardWire.isIdle()) {
+    startMicros += 1000;
+    mouseWire.advanceTo(startMicros);
+    keyboardWire.advanceTo(startMicros);
+  }
+  const auto endMicros = startMicros + config.durationMillis * 1000;
+
+  // The firmware's sender paces the packets with its esp_timer and transmit task, both on the simulated clock.
+  simSetTimeMicros(startMicros);
+  Ps2MouseSender sender(mouse);
+  if (!sender.begin()) {
+    fmt::print(stderr, "Failed to start the mouse sender\n");
+    return 1;
+  }
+  LinkPhaseEstimator linkPhase;
+  std::int64_t nextBleReportMicros = startMicros;
+  std::int64_t nextKeyMicros = startMicros;
+  std::uint32_t bleReportCount = 0;
+  std::uint8_t buttons = 0;
+  bool isKeyPressed = false;
+  while (true) {
+    auto nowMicros = std::min(std::min(nextBleReportMicros, nextKeyMicros), simGetNextTimerMicros());
+    if (nowMicros >= endMicros) {
+      break;
+    }
+    mouseWire.advanceTo(nowMicros);
+    keyboardWire.advanceTo(nowMicros);
+    simSetTimeMicros(nowMicros);
+
+    if (nowMicros == nextBleReportMicros) {
+      // Steady motion with a fast flick every second and a click every 200 reports, merged as the notify callback does.
+      linkPhase.addArrival(nowMicros);
+      if (linkPhase.isLocked()) {
+        sender.setLinkPhase(linkPhase.getAnchorMicros(), linkPhase.getIntervalMicros());
+      }
+      auto motion = bleReportCount % 133 < 4 ? config.motionPerReport * 30 : config.motionPerReport;
+      auto& input = sender.getInput();
+      input.addMotion(motion, motion / 2, bleReportCount % 50 == 0 ? 1 : 0, 0);
+      auto nextButtons = static_cast<std::uint8_t>(bleReportCount % 200 < 2 ? 0x01 : 0x00);
+      input.updateButtons(buttons, nextButtons);
+      buttons = nextButtons;
+      if (input.hasPending()) {
+        sender.requestFlush();
+      }
+      bleReportCount++;
+      nextBleReportMicros += config.bleIntervalMicros;
+    }
+    if (nowMicros == nextKeyMicros) {
+      if (isKeyPressed) {
+        keyboard.sendScanCode({0xF0, 0x1C});
+      } else {
+        keyboard.sendScanCode({0x1C});
+      }
+      isKeyPressed = !isKeyPressed;
+      nextKeyMicros += config.keyIntervalMicros;
+    }
+    simRunDueTimers();
+  }
+  mouseWire.advanceTo(endMicros);
+  keyboardWire.advanceTo(endMicros);
+
+  fmt::print("mouse.saturated_packets: {}/{}\n", mouse.getSaturatedPacketCount(), mouse.getPacketCount());
+  printStats("mouse", mouseWire, config);
+  printStats("keyboard", keyboardWire, config);
+  return 0;
+}
@@ -0,0 +1,304 @@
+#include "ps2_wire_model.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+constexpr std::int64_t NEVER = std::numeric_limits<std::int64_t>::max();
+constexpr std::uint8_t ACK = 0xFA;
+constexpr std::uint8_t RESEND = 0xFE;
+constexpr std::uint8_t SELF_TEST_PASSED = 0xAA;
+constexpr std::int64_t DEVICE_FRAME_CLOCKS = 11;  // Start, 8 data, parity and stop bits
+constexpr std::int64_t DEVICE_COMMIT_CLOCKS = 10;  // An inhibit before the 10th clock aborts the byte
+constexpr std::int64_t HOST_FRAME_CLOCKS = 12;    // 8 data, parity and stop bits plus the acknowledge bit
+
+}  // namespace
+
+Ps2WireModel::Ps2WireModel(Ps2DeviceKind kind, const Ps2WireConfig& config)
+    : kind(kind), config(config), random(config.seed), isReportingEnabled(kind == Ps2DeviceKind::Keyboard) {
+  nextInhibitMicros = config.inhibitIntervalMicros;
+}
+
+std::int64_t Ps2WireModel::getNow() const { return now; }
+
+std::int64_t Ps2WireModel::getBitMicros() const { return config.clockHalfPeriodMicros * 2; }
+
+bool Ps2WireModel::isHostReadyToSend() const {
+  return isResendRequested || (!hostCommands.empty() && !isHostAwaitingAck && hostCommandIndex < hostCommands.front().size());
+}
+
+// Returns the packet the device sends next. Stream data waits while the host is in the middle of a command.
+Ps2WireModel::Packet* Ps2WireModel::getNextPacket() {
+  if (!replyQueue.empty()) {
+    return &replyQueue.front();
+  }
+  if (!hostCommands.empty() || streamQueue.empty()) {
+    return nullptr;
+  }
+  return &streamQueue.front();
+}
+
+bool Ps2WireModel::hasDeviceData() const { return !replyQueue.empty() || !streamQueue.empty(); }
+
+std::int64_t Ps2WireModel::getNextInhibitStartMicros() const {
+  auto inhibitMicros = config.inhibitIntervalMicros > 0 ? nextInhibitMicros : NEVER;
+  if (isHostReadyToSend()) {
+    inhibitMicros = now;  // The host pulls the clock low to request to send
+  }
+  return inhibitMicros;
+}
+
+void Ps2WireModel::startPeriodicInhibits() {
+  while (config.inhibitIntervalMicros > 0 && now >= nextInhibitMicros) {
+    inhibitUntilMicros = std::max(inhibitUntilMicros, nextInhibitMicros + config.inhibitDurationMicros);
+    nextInhibitMicros += config.inhibitIntervalMicros;
+  }
+}
+
+void Ps2WireModel::advanceTo(std::int64_t untilMicros) {
+  while (step(untilMicros)) {
+  }
+}
+
+// Processes the next event if it happens no later than untilMicros. Returns false once the model has reached untilMicros.
+bool Ps2WireModel::step(std::int64_t untilMicros) {
+  startPeriodicInhibits();
+  switch (state) {
+    case State::DeviceSending: {
+      auto inhibitMicros = getNextInhibitStartMicros();
+      if (inhibitMicros < transferStartMicros + DEVICE_COMMIT_CLOCKS * getBitMicros()) {
+        if (inhibitMicros > untilMicros) {
+          now = untilMicros;
+          return false;
+        }
+        now = inhibitMicros;
+        stats.abortedFrames++;
+        stats.abortedWireMicros += now - transferStartMicros;
+        state = State::Idle;
+        return true;
+      }
+      if (transferEndMicros > untilMicros) {
+        now = untilMicros;
+        return false;
+      }
+      now = transferEndMicros;
+      finishDeviceByte();
+      return true;
+    }
+
+    case State::HostSending:
+      if (transferEndMicros > untilMicros) {
+        now = untilMicros;
+        return false;
+      }
+      now = transferEndMicros;
+      finishHostByte();
+      return true;
+
+    case State::Idle:
+      break;
+  }
+
+  auto isInhibited = now < inhibitUntilMicros;
+  if (!isInhibited && isHostReadyToSend()) {
+    state = State::HostSending;
+    transferStartMicros = now;
+    transferEndMicros = now + config.requestToSendMicros + HOST_FRAME_CLOCKS * getBitMicros();
+    return true;
+  }
+  auto packet = getNextPacket();
+  if (!isInhibited && packet != nullptr && now >= busFreeMicros && now >= packet->notBeforeMicros) {
+    state = State::DeviceSending;
+    isSendingReply = !replyQueue.empty();
+    transferStartMicros = now;
+    transferEndMicros = now + DEVICE_FRAME_CLOCKS * getBitMicros();
+    if (packet->firstByteMicros < 0) {
+      packet->firstByteMicros = now;
+    }
+    return true;
+  }
+
+  // Nothing can start now, so wait for the next change.
+  auto nextMicros = config.inhibitIntervalMicros > 0 ? nextInhibitMicros : NEVER;
+  if (isInhibited) {
+    nextMicros = std::min(nextMicros, inhibitUntilMicros);
+  } else if (packet != nullptr) {
+    nextMicros = std::min(nextMicros, std::max(busFreeMicros, packet->notBeforeMicros));
+  }
+  nextMicros = std::min(nextMicros, untilMicros);
+  if (isInhibited && hasDeviceData()) {
+    stats.inhibitedWaitMicros += nextMicros - now;
+  }
+  now = nextMicros;
+  return now < untilMicros;
+}
+
+void Ps2WireModel::finishDeviceByte() {
+  auto& queue = isSendingReply ? replyQueue : streamQueue;
+  auto& packet = queue.front();
+  state = State::Idle;
+  busFreeMicros = now + config.byteIntervalMicros;
+  inhibitUntilMicros = std::max(inhibitUntilMicros, now + config.hostHoldoffMicros);
+  if (std::uniform_real_distribution<double>(0.0, 1.0)(random) < config.parityErrorRate) {
+    // The byte stays at the head of the queue and is sent again after the host's 0xFE.
+    isResendRequested = true;
+    return;
+  }
+
+  auto data = packet.bytes[packet.sentCount++];
+  stats.deliveredBytes++;
+  if (isSendingReply && data == ACK && isHostAwaitingAck) {
+    isHostAwaitingAck = false;
+    if (hostCommandIndex == hostCommands.front().size()) {
+      if (hostCommands.front()[0] == 0xFF) {
+        isHostAwaitingSelfTest = true;
+      } else {
+        finishHostCommand(stats.commandLatencyMicros);
+      }
+    }
+  }
+  if (packet.sentCount == packet.bytes.size()) {
+    if (!isSendingReply) {
+      stats.deliveredPackets++;
+      stats.queueDelayMicros.push_back(packet.firstByteMicros - packet.enqueueMicros);
+      stats.latencyMicros.push_back(now - packet.enqueueMicros);
+    } else if (isHostAwaitingSelfTest && packet.bytes[0] == SELF_TEST_PASSED) {
+      isHostAwaitingSelfTest = false;
+      finishHostCommand(stats.resetLatencyMicros);
+    }
+    queue.pop_front();
+  }
+}
+
+void Ps2WireModel::finishHostByte() {
+  state = State::Idle;
+  std::uint8_t data;
+  if (isResendRequested) {
+    data = RESEND;
+    isResendRequested = false;
+  } else {
+    if (hostCommandIndex == 0) {
+      hostCommandStartMicros = transferStartMicros;
+    }
+    data = hostCommands.front()[hostCommandIndex++];
+    isHostAwaitingAck = true;
+  }
+  stats.hostCommandBytes++;
+  handleHostByte(data);
+}
+
+void Ps2WireModel::finishHostCommand(std::vector<std::int64_t>& latencies) {
+  latencies.push_back(now - hostCommandStartMicros);
+  hostCommands.pop_front();
+  hostCommandIndex = 0;
+}
+
+void Ps2WireModel::handleHostByte(std::uint8_t data) {
+  if (data == RESEND) {
+    stats.resentBytes++;
+    return;
+  }
+  // A command cuts the rest of a stream packet which was partly sent.
+  if (!streamQueue.empty() && streamQueue.front().sentCount > 0) {
+    streamQueue.pop_front();
+    stats.droppedPackets++;
+  }
+  if (pendingCommand != 0) {
+    if (pendingCommand == 0xF3) {
+      sampleRate = data;
+    } else {
+      leds = data;
+    }
+    pendingCommand = 0;
+    reply({ACK}, config.commandResponseMicros);
+    return;
+  }
+  switch (data) {
+    case 0xF3:  // Set sample rate (mouse) or typematic rate (keyboard)
+    case 0xED:  // Set LEDs
+      pendingCommand = data;
+      break;
+    case 0xF4:
+      isReportingEnabled = true;
+      break;
+    case 0xF5:
+      isReportingEnabled = false;
+      break;
+    case 0xFF:
+      stats.droppedPackets += streamQueue.size();
+      streamQueue.clear();
+      isReportingEnabled = kind == Ps2DeviceKind::Keyboard;
+      sampleRate = 100;
+      leds = 0;
+      reply({ACK}, config.commandResponseMicros);
+      if (kind == Ps2DeviceKind::Mouse) {
+        reply({SELF_TEST_PASSED, 0x00}, config.selfTestMicros);
+      } else {
+        reply({SELF_TEST_PASSED}, config.selfTestMicros);
+      }
+      return;
+    default:
+      break;
+  }
+  reply({ACK}, config.commandResponseMicros);
+}
+
+void Ps2WireModel::reply(std::initializer_list<std::uint8_t> bytes, std::int64_t delayMicros) {
+  Packet packet;
+  packet.bytes = bytes;
+  packet.enqueueMicros = now;
+  packet.notBeforeMicros = now + delayMicros;
+  replyQueue.push_back(packet);
+}
+
+void Ps2WireModel::sendHostCommand(const std::vector<std::uint8_t>& command) { hostCommands.push_back(command); }
+
+void Ps2WireModel::sendPacket(const std::vector<std::uint8_t>& bytes) {
+  if (!isReportingEnabled) {
+    stats.droppedPackets++;
+    return;
+  }
+  Packet packet;
+  packet.bytes = bytes;
+  packet.enqueueMicros = now;
+  streamQueue.push_back(packet);
+}
+
+bool Ps2WireModel::isIdle() const { return state == State::Idle && !hasDeviceData() && hostCommands.empty() && !isResendRequested; }
+
+bool Ps2WireModel::isReplyingToHost() const { return !replyQueue.empty() || !hostCommands.empty(); }
+
+std::uint8_t Ps2WireModel::getSampleRate() const { return sampleRate; }
+
+std::uint8_t Ps2WireModel::getLeds() const { return leds; }
+
+const Ps2WireStats& Ps2WireModel::getStats() const { return stats; }
+
+SimPs2Mouse::SimPs2Mouse(Ps2WireModel& wire, Ps2MouseType type) : wire(wire), type(type) {}
+
+std::uint8_t SimPs2Mouse::getSampleRate() { return wire.getSampleRate(); }
+
+bool SimPs2Mouse::hasWheel() { return type != Ps2MouseType::Generic; }
+
+bool SimPs2Mouse::has4thAnd5thButtons() { return type == Ps2MouseType::IntelliMouseExplorer; }
+
+bool SimPs2Mouse::isReadyToSend() { return !wire.isReplyingToHost(); }
+
+void SimPs2Mouse::sendReport(const Ps2MousePacket& packet) {
+  std::uint8_t bytes[PS2_MOUSE_PACKET_MAX_LENGTH];
+  const auto length = packet.encode(type, bytes);
+  packetCount++;
+  if (packet.isSaturated) {
+    saturatedPacketCount++;
+  }
+  wire.sendPacket(std::vector<std::uint8_t>(bytes, bytes + length));
+}
+
+std::uint32_t SimPs2Mouse::getPacketCount() const { return packetCount; }
+
+std::uint32_t SimPs2Mouse::getSaturatedPacketCount() const { return saturatedPacketCount; }
+
+SimPs2Keyboard::SimPs2Keyboard(Ps2WireModel& wire) : wire(wire) {}
+
+void SimPs2Keyboard::sendScanCode(const std::initializer_list<std::uint8_t>& scanCode) { wire.sendPacket(scanCode); }
@@ -0,0 +1,152 @@
+#ifndef C2B0E6A4_5F4D_4E0B_9C71_3A8E2D64F1B7
+#define C2B0E6A4_5F4D_4E0B_9C71_3A8E2D64F1B7
+
+#include <cstdint>
+#include <deque>
+#include <initializer_list>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ps2_port.hpp"
+
+// Software model of one PS/2 device-host link, timed in microseconds.
+// It models the framing of each byte on the clock and data lines, the host inhibiting the clock, host-to-device commands
+// with their acknowledgements, and 0xFE resend requests after parity errors, closely enough to compare pacing strategies.
+
+enum class Ps2DeviceKind {
+  Mouse,
+  Keyboard,
+};
+
+class Ps2WireConfig {
+ public:
+  std::int64_t clockHalfPeriodMicros = 40;   // 12.5 kHz clock
+  std::int64_t byteIntervalMicros = 60;      // Idle time the device leaves between bytes
+  std::int64_t hostHoldoffMicros = 0;        // Clock inhibited by the host after each received byte
+  std::int64_t inhibitIntervalMicros = 0;    // Period of additional host inhibits, 0 disables them
+  std::int64_t inhibitDurationMicros = 0;    // Length of each additional host inhibit
+  std::int64_t requestToSendMicros = 100;    // Inhibit before the host sends a byte
+  std::int64_t commandResponseMicros = 200;  // Time the device takes to answer a command
+  std::int64_t selfTestMicros = 300000;      // Time from the acknowledgement of 0xFF to 0xAA
+  double parityErrorRate = 0.0;              // Probability that the host rejects a byte with 0xFE
+  std::uint32_t seed = 1;
+};
+
+class Ps2WireStats {
+ public:
+  std::uint64_t deliveredBytes = 0;
+  std::uint64_t deliveredPackets = 0;
+  std::uint64_t droppedPackets = 0;    // Cut by a host command, or sent while data reporting was disabled
+  std::uint64_t abortedFrames = 0;     // Bytes cut by a host inhibit before the 10th clock
+  std::uint64_t resentBytes = 0;       // Bytes sent again after 0xFE
+  std::uint64_t hostCommandBytes = 0;
+  std::int64_t abortedWireMicros = 0;  // Wire time lost to aborted frames
+  std::int64_t inhibitedWaitMicros = 0;  // Time the device had data but the host inhibited the clock
+  std::vector<std::int64_t> queueDelayMicros;  // Per packet, from sendReport to the start of its first byte
+  std::vector<std::int64_t> latencyMicros;     // Per packet, from sendReport to the end of its last byte
+  std::vector<std::int64_t> commandLatencyMicros;  // Per host command but 0xFF, from its request to the last acknowledgement
+  std::vector<std::int64_t> resetLatencyMicros;    // Per 0xFF, from its request to the end of the self-test result
+};
+
+class Ps2WireModel {
+ private:
+  enum class State {
+    Idle,
+    DeviceSending,
+    HostSending,
+  };
+
+  class Packet {
+   public:
+    std::vector<std::uint8_t> bytes;
+    std::int64_t enqueueMicros = 0;
+    std::int64_t notBeforeMicros = 0;
+    std::int64_t firstByteMicros = -1;
+    std::size_t sentCount = 0;
+  };
+
+  Ps2DeviceKind kind;
+  Ps2WireConfig config;
+  Ps2WireStats stats;
+  std::mt19937 random;
+  std::int64_t now = 0;
+  State state = State::Idle;
+  std::int64_t transferStartMicros = 0;
+  std::int64_t transferEndMicros = 0;
+  bool isSendingReply = false;
+  std::int64_t inhibitUntilMicros = 0;
+  std::int64_t nextInhibitMicros = 0;
+  std::int64_t busFreeMicros = 0;  // End of the device's byte interval or command processing
+  std::deque<Packet> replyQueue;   // Answers to host commands, sent before stream data
+  std::deque<Packet> streamQueue;  // Mouse packets and scan codes
+  std::deque<std::vector<std::uint8_t>> hostCommands;
+  std::size_t hostCommandIndex = 0;
+  std::int64_t hostCommandStartMicros = 0;
+  bool isHostAwaitingAck = false;
+  bool isHostAwaitingSelfTest = false;  // After 0xFF, the host sends nothing until 0xAA
+  bool isResendRequested = false;
+  std::uint8_t pendingCommand = 0;  // Command waiting for its argument byte
+  bool isReportingEnabled;
+  std::uint8_t sampleRate = 100;
+  std::uint8_t leds = 0;
+
+  std::int64_t getBitMicros() const;
+  bool isHostReadyToSend() const;
+  bool hasDeviceData() const;
+  Packet* getNextPacket();
+  std::int64_t getNextInhibitStartMicros() const;
+  void startPeriodicInhibits();
+  void finishDeviceByte();
+  void finishHostByte();
+  void finishHostCommand(std::vector<std::int64_t>& latencies);
+  void handleHostByte(std::uint8_t data);
+  void reply(std::initializer_list<std::uint8_t> bytes, std::int64_t delayMicros);
+  bool step(std::int64_t untilMicros);
+
+ public:
+  Ps2WireModel(Ps2DeviceKind kind, const Ps2WireConfig& config);
+  std::int64_t getNow() const;
+  // Runs the link until the given time.
+  void advanceTo(std::int64_t untilMicros);
+  // Queues a command the host sends as soon as the bus allows, e.g. {0xF3, 200}.
+  void sendHostCommand(const std::vector<std::uint8_t>& command);
+  // Queues a packet of the device, as esp32_ps2dev does for a mouse report or a scan code.
+  void sendPacket(const std::vector<std::uint8_t>& bytes);
+  bool isIdle() const;
+  // True while a host command is in progress or its answer is not sent yet.
+  bool isReplyingToHost() const;
+  std::uint8_t getSampleRate() const;
+  std::uint8_t getLeds() const;
+  const Ps2WireStats& getStats() const;
+};
+
+// Ps2MousePort on top of the model. Wheel and buttons 4 and 5 are enabled as the host would through the sample rate sequences.
+class SimPs2Mouse : public Ps2MousePort {
+ private:
+  Ps2WireModel& wire;
+  Ps2MouseType type;
+  std::uint32_t packetCount = 0;
+  std::uint32_t saturatedPacketCount = 0;
+
+ public:
+  SimPs2Mouse(Ps2WireModel& wire, Ps2MouseType type);
+  std::uint8_t getSampleRate() override;
+  bool hasWheel() override;
+  bool has4thAnd5thButtons() override;
+  bool isReadyToSend() override;
+  void sendReport(const Ps2MousePacket& packet) override;
+  std::uint32_t getPacketCount() const;
+  std::uint32_t getSaturatedPacketCount() const;
+};
+
+class SimPs2Keyboard : public Ps2KeyboardPort {
+ private:
+  Ps2WireModel& wire;
+
+ public:
+  explicit SimPs2Keyboard(Ps2WireModel& wire);
+  void sendScanCode(const std::initializer_list<std::uint8_t>& scanCode) override;
+};
+
+#endif /* C2B0E6A4_5F4D_4E0B_9C71_3A8E2D64F1B7 */
@@ -0,0 +1,170 @@
+#include "sim_rtos.hpp"
+
+#include <Arduino.h>
+extern "C" {
+#include <esp_timer.h>
+}
+
+#include <algorithm>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class SimTask {
+ public:
+  TaskFunction_t function;
+  void* parameter;
+  std::uint32_t notificationCount = 0;
+  bool isRunning = true;  // From being handed over to until it blocks in ulTaskNotifyTake
+};
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void* arg;
+  std::int64_t fireMicros;  // -1 while not armed
+};
+
+namespace {
+
+// Never destroyed, since task threads stay blocked on them when the simulation exits.
+std::mutex& Mutex = *new std::mutex();
+std::condition_variable& Handover = *new std::condition_variable();
+std::vector<SimTask*>& Tasks = *new std::vector<SimTask*>();
+std::vector<esp_timer*>& Timers = *new std::vector<esp_timer*>();
+std::int64_t NowMicros = 0;
+thread_local SimTask* CurrentTask = nullptr;
+
+// Hands over to the task and waits until it blocks again.
+void runTask(std::unique_lock<std::mutex>& lock, SimTask* task) {
+  task->isRunning = true;
+  Handover.notify_all();
+  Handover.wait(lock, [task] { return !task->isRunning; });
+}
+
+void runNotifiedTasks() {
+  std::unique_lock<std::mutex> lock(Mutex);
+  for (bool isAnyRun = true; isAnyRun;) {
+    isAnyRun = false;
+    for (auto task : Tasks) {
+      if (task->notificationCount > 0) {
+        runTask(lock, task);
+        isAnyRun = true;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+// Name, stack, priority and core have no meaning on the simulated clock, where one task runs at a time.
+BaseType_t xTaskCreateUniversal(TaskFunction_t taskFunction, const char* /* name */, std::uint32_t /* stackDepth */, void* parameter,
+                                UBaseType_t /* priority */, TaskHandle_t* createdTask, BaseType_t /* core */) {
+  auto task = new SimTask{taskFunction, parameter};
+  std::unique_lock<std::mutex> lock(Mutex);
+  Tasks.push_back(task);
+  std::thread([task] {
+    CurrentTask = task;
+    task->function(task->parameter);
+  }).detach();
+  // Let the task run up to its first wait.
+  Handover.wait(lock, [task] { return !task->isRunning; });
+  if (createdTask != nullptr) {
+    *createdTask = task;
+  }
+  return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  std::lock_guard<std::mutex> lock(Mutex);
+  task->notificationCount++;
+  return pdPASS;
+}
+
+// Waits without a timeout, as the sender's transmit task does.
+std::uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t /* ticksToWait */) {
+  auto task = CurrentTask;
+  std::unique_lock<std::mutex> lock(Mutex);
+  if (task->notificationCount == 0) {
+    task->isRunning = false;
+    Handover.notify_all();
+    Handover.wait(lock, [task] { return task->isRunning; });
+  }
+  auto count = task->notificationCount;
+  task->notificationCount = clearCountOnExit ? 0 : count - 1;
+  return count;
+}
+
+const char* esp_err_to_name(esp_err_t code) {
+  switch (code) {
+    case ESP_OK:
+      return "ESP_OK";
+    case ESP_ERR_INVALID_ARG:
+      return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+      return "ESP_ERR_INVALID_STATE";
+    default:
+      return "ESP_FAIL";
+  }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args, esp_timer_handle_t* out_handle) {
+  if (create_args == nullptr || create_args->callback == nullptr || out_handle == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  auto timer = new esp_timer{create_args->callback, create_args->arg, -1};
+  std::lock_guard<std::mutex> lock(Mutex);
+  Timers.push_back(timer);
+  *out_handle = timer;
+  return ESP_OK;
+}
+
+// As in ESP-IDF, a timer which is already armed cannot be started again.
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+  std::lock_guard<std::mutex> lock(Mutex);
+  if (timer->fireMicros >= 0) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->fireMicros = NowMicros + static_cast<std::int64_t>(timeout_us);
+  return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+  std::lock_guard<std::mutex> lock(Mutex);
+  return NowMicros;
+}
+
+void simSetTimeMicros(std::int64_t nowMicros) {
+  std::lock_guard<std::mutex> lock(Mutex);
+  NowMicros = nowMicros;
+}
+
+std::int64_t simGetNextTimerMicros() {
+  std::lock_guard<std::mutex> lock(Mutex);
+  auto nextMicros = std::numeric_limits<std::int64_t>::max();
+  for (auto timer : Timers) {
+    if (timer->fireMicros >= 0) {
+      nextMicros = std::min(nextMicros, timer->fireMicros);
+    }
+  }
+  return nextMicros;
+}
+
+void simRunDueTimers() {
+  std::vector<esp_timer*> dueTimers;
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    for (auto timer : Timers) {
+      if (timer->fireMicros >= 0 && timer->fireMicros <= NowMicros) {
+        timer->fireMicros = -1;
+        dueTimers.push_back(timer);
+      }
+    }
+  }
+  // Callbacks run without the lock, as they would on the esp_timer task.
+  for (auto timer : dueTimers) {
+    timer->callback(timer->arg);
+  }
+  runNotifiedTasks();
+}
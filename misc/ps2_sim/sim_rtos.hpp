@@ -0,0 +1,17 @@
+#ifndef A4F2C8E1_6D37_4B90_8E15_C3A7B92D0F64
+#define A4F2C8E1_6D37_4B90_8E15_C3A7B92D0F64
+
+#include <cstdint>
+
+// Simulated clock behind esp_timer_get_time, esp_timer one-shot timers and FreeRTOS task notifications.
+// Each task runs on its own thread, but only one thread runs at a time: the simulation loop hands over to a task when it is
+// notified and waits until it blocks in ulTaskNotifyTake again, so a run is as deterministic as the single-threaded model.
+
+// Sets the time returned by esp_timer_get_time. Time must not go backwards.
+void simSetTimeMicros(std::int64_t nowMicros);
+// Time at which the earliest armed timer fires, or INT64_MAX if none is armed.
+std::int64_t simGetNextTimerMicros();
+// Fires the timers which are due at the current time and runs the tasks they notified until each blocks again.
+void simRunDueTimers();
+
+#endif /* A4F2C8E1_6D37_4B90_8E15_C3A7B92D0F64 */
@@ -0,0 +1,77 @@
+#include "byte_interval_tuner.hpp"
+
+#include <algorithm>
+
+namespace {
+
+constexpr std::int64_t MAX_BYTE_FRAME_MICROS = 1100;  // 11 clocks at 10 kHz, the slowest PS/2 clock
+
+}  // namespace
+
+ByteIntervalTuner::ByteIntervalTuner(std::uint32_t learnedIntervalMicros)
+    : intervalMicros(learnedIntervalMicros), learnedIntervalMicros(learnedIntervalMicros) {
+  if (!isValidInterval(learnedIntervalMicros)) {
+    this->intervalMicros = DEFAULT_INTERVAL_MICROS;
+    this->learnedIntervalMicros = DEFAULT_INTERVAL_MICROS;
+  }
+}
+
+void ByteIntervalTuner::startCalibration() {
+  isCalibrating = true;
+  floorMicros = MIN_INTERVAL_MICROS;
+  cleanPacketCount = 0;
+}
+
+bool ByteIntervalTuner::isCalibrationRunning() const { return isCalibrating; }
+
+bool ByteIntervalTuner::onPacketSent() {
+  if (++cleanPacketCount < CLEAN_PACKETS_PER_STEP) {
+    return false;
+  }
+  cleanPacketCount = 0;
+  if (!isCalibrating) {
+    if (intervalMicros == learnedIntervalMicros) {
+      learnedErrorCount = 0;  // Only errors close together count as persisting
+    }
+    // Recover from a temporary back-off.
+    intervalMicros = std::max(learnedIntervalMicros, intervalMicros > STEP_MICROS ? intervalMicros - STEP_MICROS : 0);
+    return false;
+  }
+  if (intervalMicros >= floorMicros + STEP_MICROS) {
+    intervalMicros -= STEP_MICROS;
+    return false;
+  }
+  // A full run of clean packets at the smallest interval not known to fail.
+  isCalibrating = false;
+  learnedIntervalMicros = intervalMicros;
+  learnedErrorCount = 0;
+  return true;
+}
+
+bool ByteIntervalTuner::onTransmissionError(Ps2TransmissionError error) {
+  cleanPacketCount = 0;
+  auto isLearnedChanged = false;
+  if (isCalibrating) {
+    floorMicros = std::min(intervalMicros + STEP_MICROS, MAX_INTERVAL_MICROS);
+  } else if (error == Ps2TransmissionError::Resend && intervalMicros == learnedIntervalMicros &&
+             ++learnedErrorCount >= ERRORS_TO_RAISE_LEARNED) {
+    learnedIntervalMicros = std::min(learnedIntervalMicros + STEP_MICROS, MAX_INTERVAL_MICROS);
+    learnedErrorCount = 0;
+    isLearnedChanged = true;
+  }
+  intervalMicros = std::min(std::max(intervalMicros * 2, floorMicros), MAX_INTERVAL_MICROS);
+  return isLearnedChanged;
+}
+
+std::uint32_t ByteIntervalTuner::getIntervalMicros() const { return intervalMicros; }
+
+std::uint32_t ByteIntervalTuner::getLearnedIntervalMicros() const { return learnedIntervalMicros; }
+
+bool ByteIntervalTuner::isValidInterval(std::uint32_t intervalMicros) {
+  return intervalMicros >= MIN_INTERVAL_MICROS && intervalMicros <= MAX_INTERVAL_MICROS;
+}
+
+bool isTransferInterrupted(std::int64_t elapsedMicros, std::size_t byteCount, std::uint32_t byteIntervalMicros) {
+  const auto byteMicros = MAX_BYTE_FRAME_MICROS + static_cast<std::int64_t>(byteIntervalMicros);
+  return elapsedMicros > static_cast<std::int64_t>(byteCount) * byteMicros + MAX_BYTE_FRAME_MICROS;
+}
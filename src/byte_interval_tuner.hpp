@@ -0,0 +1,63 @@
+#ifndef FC394DEB_61AB_4F2C_86E3_E0CFF282967B
+#define FC394DEB_61AB_4F2C_86E3_E0CFF282967B
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef PS2BLE_PS2_BYTE_INTERVAL_MICROS
+#define PS2BLE_PS2_BYTE_INTERVAL_MICROS 60
+#endif
+
+// Calibrate when no interval has been learned yet, i.e. on the first boot. Off by default: a host which drops or misreads
+// bytes instead of asking for a resend would get a too short interval stored for good. Calibration can always be started
+// from the web UI.
+#ifndef PS2BLE_PS2_BYTE_INTERVAL_AUTO_CALIBRATION
+#define PS2BLE_PS2_BYTE_INTERVAL_AUTO_CALIBRATION 0
+#endif
+
+// A byte the host asked to resend (0xFE), or a transfer the host interrupted by inhibiting the clock or which failed to write.
+enum class Ps2TransmissionError {
+  Resend,
+  Interrupted,
+};
+
+// Tunes the idle time a PS/2 device leaves between the bytes of a packet.
+// While calibrating, the interval shrinks one step after every run of clean packets until the host starts asking for
+// resends, then settles one step above the failing value. Outside calibration the learned interval is kept, except that
+// errors back off temporarily, and resends which persist at the learned interval raise it for good. Interrupted transfers
+// only back off, since hosts also inhibit the clock while they are busy. Not thread safe.
+class ByteIntervalTuner {
+ public:
+  static constexpr std::uint32_t MIN_INTERVAL_MICROS = 10;
+  static constexpr std::uint32_t MAX_INTERVAL_MICROS = 1000;
+  static constexpr std::uint32_t DEFAULT_INTERVAL_MICROS = PS2BLE_PS2_BYTE_INTERVAL_MICROS;
+  static constexpr std::uint32_t STEP_MICROS = 5;
+  static constexpr std::uint32_t CLEAN_PACKETS_PER_STEP = 256;
+  static constexpr std::uint32_t ERRORS_TO_RAISE_LEARNED = 3;  // Errors at the learned interval before it is raised
+
+ private:
+  std::uint32_t intervalMicros;
+  std::uint32_t learnedIntervalMicros;
+  std::uint32_t floorMicros = MIN_INTERVAL_MICROS;  // Smallest interval not known to fail
+  std::uint32_t cleanPacketCount = 0;
+  std::uint32_t learnedErrorCount = 0;
+  bool isCalibrating = false;
+
+ public:
+  explicit ByteIntervalTuner(std::uint32_t learnedIntervalMicros = DEFAULT_INTERVAL_MICROS);
+  void startCalibration();
+  bool isCalibrationRunning() const;
+  // Called after a packet the host did not ask to resend. Returns true when the learned interval changed.
+  bool onPacketSent();
+  // Called after a packet which failed. Returns true when the learned interval changed.
+  bool onTransmissionError(Ps2TransmissionError error);
+  std::uint32_t getIntervalMicros() const;
+  std::uint32_t getLearnedIntervalMicros() const;
+  static bool isValidInterval(std::uint32_t intervalMicros);
+};
+
+// Returns true if a transfer of byteCount bytes took more than one byte frame longer than the bytes and intervals need at
+// the slowest PS/2 clock, which happens when the host inhibited the clock during it and bytes were sent again.
+bool isTransferInterrupted(std::int64_t elapsedMicros, std::size_t byteCount, std::uint32_t byteIntervalMicros);
+
+#endif /* FC394DEB_61AB_4F2C_86E3_E0CFF282967B */
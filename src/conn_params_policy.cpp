@@ -0,0 +1,113 @@
+#include "conn_params_policy.hpp"
+
+#include <algorithm>
+
+namespace {
+
+constexpr std::uint16_t APPEARANCE_CATEGORY_REMOTE_CONTROL = 6;
+constexpr std::uint16_t APPEARANCE_CATEGORY_HID = 15;
+constexpr std::int32_t INTERVAL_UNIT_MICROS = 1250;
+constexpr std::uint16_t MIN_SUPERVISION_TIMEOUT = 510;  // 5.1 s
+constexpr std::uint16_t MAX_LATENCY = 30;
+
+class LinkClassPolicy {
+ public:
+  std::uint16_t baseInterval;
+  std::uint16_t latency;
+  std::uint16_t maxAcceptedFactor;  // maxAcceptedInterval in multiples of the interval
+};
+
+const LinkClassPolicy& getLinkClassPolicy(LinkClass linkClass) {
+  static const LinkClassPolicy lowLatency = {6, 0, 2};  // 7.5 ms
+  static const LinkClassPolicy standard = {12, 0, 4};   // 15 ms
+  static const LinkClassPolicy relaxed = {24, 4, 16};   // 30 ms
+  switch (linkClass) {
+    case LinkClass::LowLatency:
+      return lowLatency;
+    case LinkClass::Relaxed:
+      return relaxed;
+    default:
+      return standard;
+  }
+}
+
+}  // namespace
+
+// The upper 10 bits of an appearance are its category and the lower 6 bits its subcategory.
+LinkClass getLinkClass(std::uint16_t appearance) {
+  auto category = appearance >> 6;
+  auto subcategory = appearance & 0x3F;
+  if (category == APPEARANCE_CATEGORY_REMOTE_CONTROL) {
+    return LinkClass::Relaxed;
+  }
+  if (category != APPEARANCE_CATEGORY_HID) {
+    return LinkClass::Standard;
+  }
+  switch (subcategory) {
+    case 1:  // Keyboard
+    case 2:  // Mouse
+    case 3:  // Joystick
+    case 4:  // Gamepad
+    case 5:  // Digitizer tablet
+    case 7:  // Digital pen
+      return LinkClass::LowLatency;
+    case 6:  // Card reader
+    case 8:  // Barcode scanner
+      return LinkClass::Relaxed;
+    default:
+      return LinkClass::Standard;
+  }
+}
+
+const char* getLinkClassName(LinkClass linkClass) {
+  switch (linkClass) {
+    case LinkClass::LowLatency:
+      return "LowLatency";
+    case LinkClass::Relaxed:
+      return "Relaxed";
+    default:
+      return "Standard";
+  }
+}
+
+bool ConnParams::operator==(const ConnParams& other) const {
+  return minInterval == other.minInterval && maxInterval == other.maxInterval && latency == other.latency &&
+         supervisionTimeout == other.supervisionTimeout && maxAcceptedInterval == other.maxAcceptedInterval;
+}
+
+bool ConnParams::operator!=(const ConnParams& other) const { return !(*this == other); }
+
+std::int32_t ConnParamsPolicy::getIntervalScalePercent(const std::vector<LinkClass>& links) {
+  // Radio time of all links at their base intervals, in thousandths.
+  std::int32_t usagePermille = 0;
+  for (auto linkClass : links) {
+    usagePermille += EVENT_MICROS * 1000 / (getLinkClassPolicy(linkClass).baseInterval * INTERVAL_UNIT_MICROS);
+  }
+  const auto budgetPermille = BUDGET_PERCENT * 10;
+  if (usagePermille <= budgetPermille) {
+    return 100;
+  }
+  return (usagePermille * 100 + budgetPermille - 1) / budgetPermille;
+}
+
+ConnParams ConnParamsPolicy::getParams(LinkClass linkClass, std::int32_t intervalScalePercent) {
+  const auto& policy = getLinkClassPolicy(linkClass);
+  ConnParams params;
+  auto interval = (policy.baseInterval * std::max<std::int32_t>(intervalScalePercent, 100) + 99) / 100;
+  params.minInterval = static_cast<std::uint16_t>(std::min<std::int32_t>(interval, MAX_INTERVAL));
+  params.maxInterval = params.minInterval;
+  params.latency = policy.latency;
+  params.maxAcceptedInterval = static_cast<std::uint16_t>(std::min<std::int32_t>(params.maxInterval * policy.maxAcceptedFactor, MAX_INTERVAL));
+  // The timeout has to cover at least two intervals, counting the events the peripheral may skip. An update the
+  // peripheral asks for brings its own timeout.
+  auto minTimeout = 2 * (1 + params.latency) * params.maxInterval * INTERVAL_UNIT_MICROS / 10000 + 1;
+  params.supervisionTimeout = static_cast<std::uint16_t>(std::max<std::int32_t>(MIN_SUPERVISION_TIMEOUT, std::min(minTimeout, 3200)));
+  return params;
+}
+
+// Peripherals often ask for slave latency to save power. It only delays data sent to them, such as keyboard LEDs, so any
+// latency up to MAX_LATENCY is accepted.
+bool ConnParamsPolicy::isAcceptable(const ConnParams& params, std::uint16_t minInterval, std::uint16_t maxInterval, std::uint16_t latency) {
+  return minInterval >= params.minInterval && minInterval <= params.maxAcceptedInterval && maxInterval >= minInterval &&
+         latency <= MAX_LATENCY;
+}
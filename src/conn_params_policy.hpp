@@ -0,0 +1,46 @@
+#ifndef F213532E_32E9_43FF_B8FC_C4D139DE3854
+#define F213532E_32E9_43FF_B8FC_C4D139DE3854
+
+#include <cstdint>
+#include <vector>
+
+// How fast a link needs to be, derived from the device's GAP appearance.
+enum class LinkClass {
+  LowLatency,  // Mice, keyboards, game controllers, tablets and pens
+  Standard,    // Generic HID and unknown devices
+  Relaxed,     // Remote controls, card readers and barcode scanners
+};
+
+LinkClass getLinkClass(std::uint16_t appearance);
+const char* getLinkClassName(LinkClass linkClass);
+
+class ConnParams {
+ public:
+  std::uint16_t minInterval = 0;          // 1.25 ms units
+  std::uint16_t maxInterval = 0;          // 1.25 ms units
+  std::uint16_t latency = 0;              // Connection events the peripheral may skip when it has nothing to send
+  std::uint16_t supervisionTimeout = 0;   // 10 ms units
+  std::uint16_t maxAcceptedInterval = 0;  // Slowest interval accepted when the peripheral asks for an update
+
+  bool operator==(const ConnParams& other) const;
+  bool operator!=(const ConnParams& other) const;
+};
+
+// Chooses the connection parameters of each link. Every link has a base interval for its class, and when the links
+// together would need more radio time than the budget, all base intervals are stretched by the same scale. Adding a
+// device therefore slows every link by a known factor instead of letting the controller drop events unpredictably.
+class ConnParamsPolicy {
+ public:
+  static constexpr std::int32_t EVENT_MICROS = 1250;  // Radio time assumed per connection event
+  static constexpr std::int32_t BUDGET_PERCENT = 50;  // Share of radio time for all links, the rest is left to scanning and Wi-Fi
+  static constexpr std::uint16_t MAX_INTERVAL = 400;  // 500 ms, keeps the supervision timeout within the limit
+
+  // Scale in percent applied to the base interval of every link, at least 100.
+  static std::int32_t getIntervalScalePercent(const std::vector<LinkClass>& links);
+  static ConnParams getParams(LinkClass linkClass, std::int32_t intervalScalePercent);
+  // Whether parameters a peripheral asked for fit the link's policy: not faster than the budget allows and not slower
+  // than the class tolerates.
+  static bool isAcceptable(const ConnParams& params, std::uint16_t minInterval, std::uint16_t maxInterval, std::uint16_t latency);
+};
+
+#endif /* F213532E_32E9_43FF_B8FC_C4D139DE3854 */
@@ -0,0 +1,61 @@
+#include "connect_candidates.hpp"
+
+bool ConnectCandidateTable::isBetter(const ConnectCandidate& a, const ConnectCandidate& b) {
+  if (a.isBonded != b.isBonded) {
+    return a.isBonded;
+  }
+  return a.rssi > b.rssi;
+}
+
+void ConnectCandidateTable::removeAt(std::size_t index) {
+  candidates[index] = candidates[count - 1];
+  count--;
+}
+
+bool ConnectCandidateTable::offer(const ConnectCandidate& candidate) {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (std::size_t i = 0; i < count; i++) {
+    if (candidates[i].address == candidate.address) {
+      candidates[i] = candidate;
+      return false;
+    }
+  }
+  if (count < CAPACITY) {
+    candidates[count++] = candidate;
+    return true;
+  }
+  std::size_t worst = 0;
+  for (std::size_t i = 1; i < count; i++) {
+    if (isBetter(candidates[worst], candidates[i])) {
+      worst = i;
+    }
+  }
+  if (isBetter(candidate, candidates[worst])) {
+    candidates[worst] = candidate;
+    return true;
+  }
+  return false;
+}
+
+bool ConnectCandidateTable::takeBest(std::int64_t nowMicros, ConnectCandidate& candidate) {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (std::size_t i = 0; i < count;) {
+    if (nowMicros - candidates[i].lastSeenMicros > STALE_MICROS) {
+      removeAt(i);
+    } else {
+      i++;
+    }
+  }
+  if (count == 0) {
+    return false;
+  }
+  std::size_t best = 0;
+  for (std::size_t i = 1; i < count; i++) {
+    if (isBetter(candidates[i], candidates[best])) {
+      best = i;
+    }
+  }
+  candidate = candidates[best];
+  removeAt(best);
+  return true;
+}
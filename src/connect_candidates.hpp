@@ -0,0 +1,42 @@
+#ifndef D704B62B_EDAD_487F_B4ED_5BB250709FDF
+#define D704B62B_EDAD_487F_B4ED_5BB250709FDF
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+
+// A device seen advertising which taskConnect may connect to.
+class ConnectCandidate {
+ public:
+  std::uint64_t address = 0;  // 48-bit address, the first byte of NimBLEAddress::getNative() in the lowest bits
+  std::uint8_t addressType = 0;
+  std::int8_t rssi = 0;
+  std::int64_t lastSeenMicros = 0;
+  bool isBonded = false;
+};
+
+// Fixed-size table of connection candidates, filled from the scan callbacks and drained by taskConnect. Repeated
+// advertisements of a device update its entry instead of adding one, so a device which keeps advertising cannot crowd
+// out the others, and offering never waits for the consumer.
+class ConnectCandidateTable {
+ public:
+  static constexpr std::size_t CAPACITY = 8;
+  static constexpr std::int64_t STALE_MICROS = 3000000;  // Older entries are dropped as the device may have gone
+
+ private:
+  std::array<ConnectCandidate, CAPACITY> candidates;
+  std::size_t count = 0;
+  std::mutex mutex;
+
+  static bool isBetter(const ConnectCandidate& a, const ConnectCandidate& b);
+  void removeAt(std::size_t index);
+
+ public:
+  // Adds or refreshes the device. When the table is full, the least preferred entry is replaced if the new one is
+  // preferred to it. Returns true if the device was not in the table.
+  bool offer(const ConnectCandidate& candidate);
+  // Removes and returns the preferred candidate which is not stale: bonded devices first, then the strongest signal.
+  bool takeBest(std::int64_t nowMicros, ConnectCandidate& candidate);
+};
+
+#endif /* D704B62B_EDAD_487F_B4ED_5BB250709FDF */
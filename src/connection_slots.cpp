@@ -0,0 +1,30 @@
+#include "connection_slots.hpp"
+
+int ConnectionSlotPolicy::getPriority(bool isPinned, bool isBonded) {
+  if (isPinned) {
+    return PRIORITY_PINNED;
+  }
+  return isBonded ? PRIORITY_BONDED : PRIORITY_NEW;
+}
+
+SlotDecision ConnectionSlotPolicy::decide(const std::vector<LinkSlot>& links, std::size_t maxLinks, int priority, std::int64_t nowMicros,
+                                          std::size_t& evictIndex) {
+  if (links.size() < maxLinks) {
+    return SlotDecision::Admit;
+  }
+  auto isFound = false;
+  for (std::size_t i = 0; i < links.size(); i++) {
+    const auto& link = links[i];
+    auto isIdle = nowMicros - link.lastActivityMicros >= IDLE_MICROS;
+    if (link.priority > priority || (link.priority == priority && !isIdle)) {
+      continue;
+    }
+    // Lower priorities go first, then the link idle for the longest time.
+    if (!isFound || link.priority < links[evictIndex].priority ||
+        (link.priority == links[evictIndex].priority && link.lastActivityMicros < links[evictIndex].lastActivityMicros)) {
+      evictIndex = i;
+      isFound = true;
+    }
+  }
+  return isFound ? SlotDecision::Evict : SlotDecision::Reject;
+}
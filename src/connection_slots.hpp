@@ -0,0 +1,37 @@
+#ifndef D1FE5881_CA99_4EDD_8F1A_3A85B3B88EF7
+#define D1FE5881_CA99_4EDD_8F1A_3A85B3B88EF7
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A connected link as seen by the slot policy.
+class LinkSlot {
+ public:
+  std::uint64_t address = 0;
+  int priority = 0;
+  std::int64_t lastActivityMicros = 0;  // Last input report, or the connection time before the first one
+};
+
+enum class SlotDecision {
+  Admit,   // A slot is free
+  Evict,   // The link at evictIndex has to be disconnected first
+  Reject,  // No link may give way to the device
+};
+
+// Decides which devices get one of the controller's connection slots. Pinned devices come before other bonded devices,
+// which come before new devices. A device which finds every slot taken replaces the least recently active link of a
+// lower priority, or of the same priority if that link has been idle for IDLE_MICROS.
+class ConnectionSlotPolicy {
+ public:
+  static constexpr int PRIORITY_NEW = 0;
+  static constexpr int PRIORITY_BONDED = 1;
+  static constexpr int PRIORITY_PINNED = 2;
+  static constexpr std::int64_t IDLE_MICROS = 600000000;  // 10 min
+
+  static int getPriority(bool isPinned, bool isBonded);
+  static SlotDecision decide(const std::vector<LinkSlot>& links, std::size_t maxLinks, int priority, std::int64_t nowMicros,
+                             std::size_t& evictIndex);
+};
+
+#endif /* D1FE5881_CA99_4EDD_8F1A_3A85B3B88EF7 */
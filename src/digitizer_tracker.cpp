@@ -0,0 +1,128 @@
+#include "digitizer_tracker.hpp"
+
+#include <algorithm>
+
+void DigitizerTracker::setLayout(const DigitizerReportLayout& layout) {
+  *this = DigitizerTracker();
+  this->layout = layout;
+}
+
+const DigitizerReportLayout& DigitizerTracker::getLayout() const { return layout; }
+
+bool DigitizerTracker::update(const DigitizerReport& report, MouseReport& mouseReport) {
+  auto isInFrame = receivedContactCount < expectedContactCount;
+  if (!isInFrame || report.frameContactCount > 0) {
+    for (auto& contact : contacts) {
+      contact.isUpdated = false;
+    }
+    // Contacts beyond the table size are never reported completely, so they must not hold the frame open.
+    expectedContactCount = std::min<std::size_t>(report.frameContactCount > 0 ? report.frameContactCount : report.contactCount,
+                                                 MAX_DIGITIZER_CONTACTS);
+    receivedContactCount = 0;
+  }
+  for (size_t i = 0; i < report.contactCount && receivedContactCount < expectedContactCount; i++) {
+    updateContact(report.contacts[i]);
+    receivedContactCount++;
+  }
+
+  std::copy(std::begin(report.isButtonPressed), std::end(report.isButtonPressed), std::begin(isButtonPressed));
+  if (layout.isPen && report.contactCount > 0) {
+    // The pen tip clicks and the barrel switch is the secondary button.
+    isButtonPressed[0] = isButtonPressed[0] || report.contacts[0].isTouching;
+    isButtonPressed[1] = isButtonPressed[1] || report.isBarrelSwitchPressed;
+  }
+
+  if (receivedContactCount < expectedContactCount) {
+    return false;
+  }
+  finishFrame(mouseReport);
+  return true;
+}
+
+void DigitizerTracker::updateContact(const DigitizerContact& reportedContact) {
+  // A pen moves the pointer while hovering, a finger only while touching.
+  auto isTracking = layout.isPen ? reportedContact.isInRange : reportedContact.isTouching;
+  Contact* slot = nullptr;
+  for (auto& contact : contacts) {
+    if (contact.isActive && contact.id == reportedContact.id) {
+      slot = &contact;
+      break;
+    }
+  }
+  if (slot == nullptr) {
+    if (!isTracking) {
+      return;
+    }
+    for (auto& contact : contacts) {
+      if (!contact.isActive && !contact.isUpdated) {
+        slot = &contact;
+        slot->wasActive = false;
+        break;
+      }
+    }
+    if (slot == nullptr) {
+      return;  // More contacts than the table holds
+    }
+  }
+  slot->id = reportedContact.id;
+  slot->x = reportedContact.x;
+  slot->y = reportedContact.y;
+  slot->isActive = isTracking;
+  slot->isUpdated = true;
+}
+
+void DigitizerTracker::finishFrame(MouseReport& mouseReport) {
+  mouseReport = MouseReport();
+  std::int32_t activeCount = 0;
+  std::int32_t movedCount = 0;
+  std::int32_t deltaSumX = 0;
+  std::int32_t deltaSumY = 0;
+  for (auto& contact : contacts) {
+    // A contact missing from a complete frame has been lifted.
+    contact.isActive = contact.isActive && contact.isUpdated;
+    if (!contact.isActive) {
+      continue;
+    }
+    activeCount++;
+    if (contact.wasActive) {
+      movedCount++;
+      deltaSumX += contact.x - contact.lastX;
+      deltaSumY += contact.y - contact.lastY;
+    }
+  }
+
+  // Motion is only generated while the set of contacts is unchanged, so touching down or lifting a finger does not jump.
+  if (activeCount == previousActiveCount && movedCount == activeCount && (activeCount == 1 || activeCount == 2)) {
+    auto x = toCounts(deltaSumX, movedCount, remainderX);
+    auto y = toCounts(deltaSumY, movedCount, remainderY);
+    if (activeCount == 1) {
+      mouseReport.x = x;
+      mouseReport.y = y;
+    } else {
+      mouseReport.wheelVertical = y;
+      mouseReport.wheelHorizontal = -x;
+    }
+  } else {
+    remainderX = 0;
+    remainderY = 0;
+  }
+
+  for (auto& contact : contacts) {
+    contact.wasActive = contact.isActive;
+    contact.lastX = contact.x;
+    contact.lastY = contact.y;
+  }
+  previousActiveCount = activeCount;
+  std::copy(std::begin(isButtonPressed), std::end(isButtonPressed), std::begin(mouseReport.isButtonPressed));
+}
+
+// Converts the summed logical movement of contactCount contacts into the average movement in pointer counts.
+// Both axes use the X scale, so the aspect ratio of the movement is kept.
+std::int32_t DigitizerTracker::toCounts(std::int32_t deltaSum, std::int32_t contactCount, std::int32_t& remainder) const {
+  const std::int64_t logicalWidth = std::max<std::int64_t>(static_cast<std::int64_t>(layout.xLogicalMax) - layout.xLogicalMin, 1);
+  const auto denominator = logicalWidth * contactCount;
+  const auto numerator = static_cast<std::int64_t>(deltaSum) * WIDTH_COUNTS + remainder;
+  const auto counts = numerator / denominator;
+  remainder = static_cast<std::int32_t>(numerator - counts * denominator);
+  return static_cast<std::int32_t>(counts);
+}
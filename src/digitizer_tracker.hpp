@@ -0,0 +1,64 @@
+#ifndef ABE02F40_F4C8_4174_A1F8_3AE87FA6AB00
+#define ABE02F40_F4C8_4174_A1F8_3AE87FA6AB00
+
+#include <array>
+#include <cstdint>
+
+#include "hid/digitizer.hpp"
+#include "hid/mouse.hpp"
+
+#ifndef PS2BLE_DIGITIZER_WIDTH_COUNTS
+#define PS2BLE_DIGITIZER_WIDTH_COUNTS 1000
+#endif
+
+#ifndef PS2BLE_DIGITIZER_SCROLL_COUNTS_PER_DETENT
+#define PS2BLE_DIGITIZER_SCROLL_COUNTS_PER_DETENT 50
+#endif
+
+// Converts the absolute contacts of a touch pad or pen into relative mouse input.
+// One contact moves the pointer and two contacts scroll, following the fingers like a touch screen. Contacts are kept in a
+// fixed-size table and each report costs at most O(MAX_DIGITIZER_CONTACTS^2), so neither memory nor per-report time grows
+// with the report rate. Not thread safe.
+class DigitizerTracker {
+ public:
+  // Pointer counts for a movement across the full width of the digitizer
+  static constexpr std::int32_t WIDTH_COUNTS = PS2BLE_DIGITIZER_WIDTH_COUNTS;
+  // Scroll distance in pointer counts per wheel detent, to be used as the wheel resolution of the converted reports
+  static constexpr std::int32_t SCROLL_COUNTS_PER_DETENT = PS2BLE_DIGITIZER_SCROLL_COUNTS_PER_DETENT;
+
+ private:
+  class Contact {
+   public:
+    std::uint32_t id = 0;
+    std::int32_t x = 0;
+    std::int32_t y = 0;
+    std::int32_t lastX = 0;
+    std::int32_t lastY = 0;
+    bool isActive = false;
+    bool wasActive = false;  // Active in the previous frame, so lastX and lastY are valid
+    bool isUpdated = false;  // Reported in the current frame
+  };
+
+  DigitizerReportLayout layout;
+  std::array<Contact, MAX_DIGITIZER_CONTACTS> contacts;
+  std::uint8_t expectedContactCount = 0;
+  std::uint8_t receivedContactCount = 0;
+  std::uint8_t previousActiveCount = 0;
+  std::int32_t remainderX = 0;
+  std::int32_t remainderY = 0;
+  bool isButtonPressed[8] = {false};
+
+  void updateContact(const DigitizerContact& reportedContact);
+  void finishFrame(MouseReport& mouseReport);
+  std::int32_t toCounts(std::int32_t deltaSum, std::int32_t contactCount, std::int32_t& remainder) const;
+
+ public:
+  // Sets the layout of the reports and forgets all contacts.
+  void setLayout(const DigitizerReportLayout& layout);
+  const DigitizerReportLayout& getLayout() const;
+  // Returns true and fills mouseReport once all contacts of a frame have been reported.
+  // Touch pads in hybrid mode split a frame across several reports, the first of which carries the contact count.
+  bool update(const DigitizerReport& report, MouseReport& mouseReport);
+};
+
+#endif /* ABE02F40_F4C8_4174_A1F8_3AE87FA6AB00 */
@@ -0,0 +1,31 @@
+#include "gatt_cache.hpp"
+
+namespace {
+
+constexpr std::size_t ENTRY_LENGTH = 4;
+
+}  // namespace
+
+std::vector<std::uint8_t> encodeHandleReportReferenceMap(const HandleReportReferenceMap& map) {
+  std::vector<std::uint8_t> data;
+  data.reserve(map.size() * ENTRY_LENGTH);
+  for (const auto& [handle, reference] : map) {
+    data.push_back(handle & 0xFF);
+    data.push_back(handle >> 8);
+    data.push_back(reference.reportID);
+    data.push_back(reference.reportType);
+  }
+  return data;
+}
+
+bool decodeHandleReportReferenceMap(const std::uint8_t* data, std::size_t length, HandleReportReferenceMap& map) {
+  if (length == 0 || length % ENTRY_LENGTH != 0) {
+    return false;
+  }
+  map.clear();
+  for (std::size_t i = 0; i < length; i += ENTRY_LENGTH) {
+    auto handle = static_cast<std::uint16_t>(data[i] | data[i + 1] << 8);
+    map[handle] = ReportReference{data[i + 2], data[i + 3]};
+  }
+  return true;
+}
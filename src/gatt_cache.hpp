@@ -0,0 +1,26 @@
+#ifndef C45AC52E_917C_404A_95CC_6C4FE7554238
+#define C45AC52E_917C_404A_95CC_6C4FE7554238
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "hid/common.hpp"
+
+// Contents of the Report Reference descriptor of a HID Report characteristic.
+class ReportReference {
+ public:
+  reportID_t reportID = 0;
+  std::uint8_t reportType = 0;
+};
+
+// Report references by characteristic handle. Kept in NVS for bonded devices, whose attribute handles stay the same until
+// they indicate Service Changed, so the descriptors are not read again on reconnect.
+using HandleReportReferenceMap = std::map<std::uint16_t, ReportReference>;
+
+// 4 bytes per characteristic: handle (little endian), report ID and report type.
+std::vector<std::uint8_t> encodeHandleReportReferenceMap(const HandleReportReferenceMap& map);
+bool decodeHandleReportReferenceMap(const std::uint8_t* data, std::size_t length, HandleReportReferenceMap& map);
+
+#endif /* C45AC52E_917C_404A_95CC_6C4FE7554238 */
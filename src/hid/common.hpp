@@ -15,6 +15,7 @@ enum class UsagePage : usagePage_t {
   KEYBOARD_KEYPAD = 0x07,
   BUTTON = 0x09,
   CONSUMER = 0x0C,
+  DIGITIZER = 0x0D,
 };
 
 // Usage Page: Generic Desktop (0x01)
@@ -27,6 +28,7 @@ enum class UsageIDGenericDesktop : usageID_t {
   Y = 0x31,
   // Miscellaneous Controls
   WHEEL = 0x38,
+  RESOLUTION_MULTIPLIER = 0x48,
 };
 
 // Usage Page: Keyboard/Keypad (0x07)
@@ -292,4 +294,20 @@ enum class UsageIDConsumer : usageID_t {
   AC_PAN = 0x0238,
 };
 
+// Usage Page: Digitizer (0x0D)
+enum class UsageIDDigitizer : usageID_t {
+  // Application Usages
+  DIGITIZER = 0x01,
+  PEN = 0x02,
+  TOUCH_PAD = 0x05,
+  // Contact States
+  IN_RANGE = 0x32,
+  TIP_SWITCH = 0x42,
+  BARREL_SWITCH = 0x44,
+  CONFIDENCE = 0x47,
+  // Multi-Contact
+  CONTACT_IDENTIFIER = 0x51,
+  CONTACT_COUNT = 0x54,
+};
+
 #endif /* FE3F00B9_D7D2_4886_8ED7_4EC0F689ABDE */
@@ -0,0 +1,154 @@
+#include "digitizer.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstdint>
+
+#include "common.hpp"
+#include "util.hpp"
+
+std::string DigitizerReport::toString() {
+  std::string contactsString;
+  for (size_t i = 0; i < contactCount; i++) {
+    const auto& c = contacts[i];
+    contactsString += fmt::format("{}{{id: {}, isTouching: {}, isInRange: {}, x: {}, y: {}}}", i == 0 ? "" : ", ", c.id, c.isTouching,
+                                  c.isInRange, c.x, c.y);
+  }
+  return fmt::format(
+      "DigitizerReport {{contacts: [{}], frameContactCount: {}, isBarrelSwitchPressed: {}, isButtonPressed: [{}, {}, {}, {}, {}, {}, {}, "
+      "{}]}}",
+      contactsString, frameContactCount, isBarrelSwitchPressed, isButtonPressed[0], isButtonPressed[1], isButtonPressed[2],
+      isButtonPressed[3], isButtonPressed[4], isButtonPressed[5], isButtonPressed[6], isButtonPressed[7]);
+}
+
+namespace {
+
+void setField(MouseReportField& field, std::uint32_t bitOffset, std::uint32_t bitSize, std::size_t& byteLength) {
+  field.bitOffset = bitOffset;
+  field.bitSize = bitSize;
+  byteLength = std::max<std::size_t>(byteLength, (bitOffset + bitSize + 7) / 8);
+}
+
+bool isFieldPresent(const MouseReportField& field) { return field.bitSize != 0; }
+
+bool extractFlag(const std::uint8_t* rawReport, const MouseReportField& field) {
+  return extractBitsUnsigned(rawReport, field.bitOffset, field.bitSize) != 0;
+}
+
+}  // namespace
+
+DigitizerReportLayout getDigitizerReportLayout(const ReportItemList& inputReportItemList) {
+  DigitizerReportLayout layout;
+  layout.isPen = inputReportItemList.getUsageID() == static_cast<usageID_t>(UsageIDDigitizer::PEN);
+  DigitizerContactLayout* contact = nullptr;
+  // Multi-contact reports repeat the same fields once per finger, so a field which is already set starts the next contact.
+  auto getContactField = [&](MouseReportField DigitizerContactLayout::*member) -> MouseReportField* {
+    if (contact == nullptr || isFieldPresent(contact->*member)) {
+      if (layout.contactLayoutCount == MAX_DIGITIZER_CONTACTS) {
+        return nullptr;
+      }
+      contact = &layout.contacts[layout.contactLayoutCount++];
+    }
+    return &(contact->*member);
+  };
+
+  for (auto item : inputReportItemList.getItems()) {
+    const auto usagePage = item->getUsagePage();
+    const auto reportSize = item->getReportSize();
+    const auto reportCount = item->getReportCount();
+    // Buttons of a touch pad, e.g. the one under a clickpad
+    if (usagePage == static_cast<usagePage_t>(UsagePage::BUTTON)) {
+      if (item->getUsageIDs().empty() || reportSize != 1) {
+        continue;
+      }
+      auto firstUsageID = item->getUsageIDs()[0];
+      if (firstUsageID == 0 || firstUsageID > 8) {
+        continue;
+      }
+      auto buttonCount = std::min<std::uint32_t>(reportCount, 8 - (firstUsageID - 1));
+      setField(layout.buttons, item->getBitOffset(), buttonCount, layout.byteLength);
+      layout.firstButtonIndex = firstUsageID - 1;
+      continue;
+    }
+
+    auto bitOffset = item->getBitOffset();
+    const auto& usageIDs = item->getUsageIDs();
+    for (size_t i = 0; i < usageIDs.size() && i < reportCount; i++, bitOffset += reportSize) {
+      const auto usageID = usageIDs[i];
+      MouseReportField* field = nullptr;
+      if (usagePage == static_cast<usagePage_t>(UsagePage::GENERIC_DESKTOP)) {
+        if (usageID == static_cast<usageID_t>(UsageIDGenericDesktop::X)) {
+          field = getContactField(&DigitizerContactLayout::x);
+          if (field != nullptr && layout.contactLayoutCount == 1) {
+            layout.xLogicalMin = item->getLogicalMin();
+            layout.xLogicalMax = item->getLogicalMax();
+          }
+        } else if (usageID == static_cast<usageID_t>(UsageIDGenericDesktop::Y)) {
+          field = getContactField(&DigitizerContactLayout::y);
+        }
+      } else if (usagePage == static_cast<usagePage_t>(UsagePage::DIGITIZER)) {
+        switch (static_cast<UsageIDDigitizer>(usageID)) {
+          case UsageIDDigitizer::TIP_SWITCH:
+            field = getContactField(&DigitizerContactLayout::tipSwitch);
+            break;
+          case UsageIDDigitizer::IN_RANGE:
+            field = getContactField(&DigitizerContactLayout::inRange);
+            break;
+          case UsageIDDigitizer::CONFIDENCE:
+            field = getContactField(&DigitizerContactLayout::confidence);
+            break;
+          case UsageIDDigitizer::CONTACT_IDENTIFIER:
+            field = getContactField(&DigitizerContactLayout::contactIdentifier);
+            break;
+          case UsageIDDigitizer::CONTACT_COUNT:
+            field = &layout.contactCount;
+            break;
+          case UsageIDDigitizer::BARREL_SWITCH:
+            field = &layout.barrelSwitch;
+            break;
+          default:
+            break;
+        }
+      }
+      if (field != nullptr) {
+        setField(*field, bitOffset, reportSize, layout.byteLength);
+      }
+    }
+  }
+  return layout;
+}
+
+DigitizerReport decodeDigitizerInputReport(const std::uint8_t* rawReport, const DigitizerReportLayout& layout) {
+  DigitizerReport report;
+  for (size_t i = 0; i < layout.contactLayoutCount; i++) {
+    const auto& contactLayout = layout.contacts[i];
+    if (!isFieldPresent(contactLayout.x) || !isFieldPresent(contactLayout.y)) {
+      continue;
+    }
+    auto& contact = report.contacts[report.contactCount++];
+    contact.id = isFieldPresent(contactLayout.contactIdentifier)
+                     ? extractBitsUnsigned(rawReport, contactLayout.contactIdentifier.bitOffset, contactLayout.contactIdentifier.bitSize)
+                     : i;
+    contact.isTouching = !isFieldPresent(contactLayout.tipSwitch) || extractFlag(rawReport, contactLayout.tipSwitch);
+    contact.isInRange = isFieldPresent(contactLayout.inRange) ? extractFlag(rawReport, contactLayout.inRange) : contact.isTouching;
+    if (isFieldPresent(contactLayout.confidence) && !extractFlag(rawReport, contactLayout.confidence)) {
+      contact.isTouching = false;
+    }
+    contact.x = extractBitsUnsigned(rawReport, contactLayout.x.bitOffset, contactLayout.x.bitSize);
+    contact.y = extractBitsUnsigned(rawReport, contactLayout.y.bitOffset, contactLayout.y.bitSize);
+  }
+  if (isFieldPresent(layout.contactCount)) {
+    report.frameContactCount = extractBitsUnsigned(rawReport, layout.contactCount.bitOffset, layout.contactCount.bitSize);
+  }
+  if (isFieldPresent(layout.barrelSwitch)) {
+    report.isBarrelSwitchPressed = extractFlag(rawReport, layout.barrelSwitch);
+  }
+  if (isFieldPresent(layout.buttons)) {
+    auto data = extractBitsUnsigned(rawReport, layout.buttons.bitOffset, layout.buttons.bitSize);
+    for (size_t i = 0; i < layout.buttons.bitSize; i++) {
+      report.isButtonPressed[layout.firstButtonIndex + i] = data & (1 << i);
+    }
+  }
+  return report;
+}
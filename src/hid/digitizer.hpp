@@ -0,0 +1,60 @@
+#ifndef B290246C_C310_4EC9_B4B7_D1AC2E0151DC
+#define B290246C_C310_4EC9_B4B7_D1AC2E0151DC
+
+#include <cstdint>
+
+#include "mouse.hpp"
+#include "report_map.hpp"
+
+// Contacts beyond this number in a single report are ignored.
+constexpr std::size_t MAX_DIGITIZER_CONTACTS = 5;
+
+// Field locations of one contact (a finger, or the pen) in a digitizer input report.
+class DigitizerContactLayout {
+ public:
+  MouseReportField tipSwitch;
+  MouseReportField inRange;
+  MouseReportField confidence;
+  MouseReportField contactIdentifier;
+  MouseReportField x;
+  MouseReportField y;
+};
+
+// Field locations of a digitizer (touch pad or pen) input report, resolved once per report ID.
+class DigitizerReportLayout {
+ public:
+  DigitizerContactLayout contacts[MAX_DIGITIZER_CONTACTS];
+  std::uint8_t contactLayoutCount = 0;
+  MouseReportField contactCount;  // Number of contacts in this frame. Only the first report of a hybrid mode frame sets it.
+  MouseReportField barrelSwitch;
+  MouseReportField buttons;  // Bitmap, bit 0 is button firstButtonIndex
+  std::uint8_t firstButtonIndex = 0;
+  std::int32_t xLogicalMin = 0;
+  std::int32_t xLogicalMax = 0;
+  bool isPen = false;
+  std::size_t byteLength = 0;  // Minimum report length which contains all fields
+};
+
+class DigitizerContact {
+ public:
+  std::uint32_t id = 0;
+  bool isTouching = false;  // Tip switch, cleared if the device rejects the contact as a palm
+  bool isInRange = false;   // Equal to isTouching if the device does not report hovering
+  std::int32_t x = 0;
+  std::int32_t y = 0;
+};
+
+class DigitizerReport {
+ public:
+  DigitizerContact contacts[MAX_DIGITIZER_CONTACTS];
+  std::uint8_t contactCount = 0;       // Valid entries of contacts
+  std::uint8_t frameContactCount = 0;  // Value of the Contact Count field, 0 if absent or not the first report of a frame
+  bool isBarrelSwitchPressed = false;
+  bool isButtonPressed[8] = {false};
+  std::string toString();
+};
+
+DigitizerReportLayout getDigitizerReportLayout(const ReportItemList& inputReportItemList);
+DigitizerReport decodeDigitizerInputReport(const std::uint8_t* rawReport, const DigitizerReportLayout& layout);
+
+#endif /* B290246C_C310_4EC9_B4B7_D1AC2E0151DC */
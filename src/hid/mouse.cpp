@@ -2,6 +2,7 @@
 
 #include <fmt/core.h>
 
+#include <algorithm>
 #include <cstdint>
 
 #include "common.hpp"
@@ -14,8 +15,25 @@ std::string MouseReport::toString() {
       isButtonPressed[5], isButtonPressed[6], isButtonPressed[7]);
 }
 
-MouseReport decodeMouseInputReport(const std::uint8_t* rawReport, const ReportItemList& inputReportItemList) {
-  MouseReport mouseReport;
+namespace {
+
+void setField(MouseReportField& field, std::uint32_t bitOffset, std::uint32_t bitSize, std::size_t& byteLength) {
+  field.bitOffset = bitOffset;
+  field.bitSize = bitSize;
+  byteLength = std::max<std::size_t>(byteLength, (bitOffset + bitSize + 7) / 8);
+}
+
+std::int32_t extractField(const std::uint8_t* rawReport, const MouseReportField& field) {
+  if (field.bitSize == 0) {
+    return 0;
+  }
+  return extractBitsSigned(rawReport, field.bitOffset, field.bitSize);
+}
+
+}  // namespace
+
+MouseReportLayout getMouseReportLayout(const ReportItemList& inputReportItemList) {
+  MouseReportLayout layout;
   for (auto item : inputReportItemList.getItems()) {
     const auto usagePage = item->getUsagePage();
     const auto reportSize = item->getReportSize();
@@ -26,11 +44,11 @@ MouseReport decodeMouseInputReport(const std::uint8_t* rawReport, const ReportIt
       auto bitOffset = item->getBitOffset();
       for (auto usageID : item->getUsageIDs()) {
         if (usageID == static_cast<usageID_t>(UsageIDGenericDesktop::X)) {
-          mouseReport.x = extractBitsSigned(rawReport, bitOffset, reportSize);
+          setField(layout.x, bitOffset, reportSize, layout.byteLength);
         } else if (usageID == static_cast<usageID_t>(UsageIDGenericDesktop::Y)) {
-          mouseReport.y = extractBitsSigned(rawReport, bitOffset, reportSize);
+          setField(layout.y, bitOffset, reportSize, layout.byteLength);
         } else if (usageID == static_cast<usageID_t>(UsageIDGenericDesktop::WHEEL)) {
-          mouseReport.wheelVertical = extractBitsSigned(rawReport, bitOffset, reportSize);
+          setField(layout.wheelVertical, bitOffset, reportSize, layout.byteLength);
         }
         bitOffset += reportSize;
       }
@@ -41,7 +59,7 @@ MouseReport decodeMouseInputReport(const std::uint8_t* rawReport, const ReportIt
       auto bitOffset = item->getBitOffset();
       for (auto usageID : item->getUsageIDs()) {
         if (usageID == static_cast<usageID_t>(UsageIDConsumer::AC_PAN)) {
-          mouseReport.wheelHorizontal = extractBitsSigned(rawReport, bitOffset, reportSize);
+          setField(layout.wheelHorizontal, bitOffset, reportSize, layout.byteLength);
         }
         bitOffset += reportSize;
       }
@@ -59,15 +77,69 @@ MouseReport decodeMouseInputReport(const std::uint8_t* rawReport, const ReportIt
         continue;
       }
       auto firstUsageID = item->getUsageIDs()[0];
-      auto data = extractBitsUnsigned(rawReport, item->getBitOffset(), reportCount);
-      for (size_t i = 0; i < item->getReportCount(); i++) {
-        auto buttonIndex = firstUsageID + i - 1;
-        if (buttonIndex >= 0 && buttonIndex < 8) {
-          mouseReport.isButtonPressed[buttonIndex] = data & (1 << i);
-        }
+      if (firstUsageID == 0 || firstUsageID > 8) {
+        continue;
       }
+      // Buttons beyond the 8th are never reported, so they are not extracted at all.
+      auto buttonCount = std::min<std::uint32_t>(reportCount, 8 - (firstUsageID - 1));
+      setField(layout.buttons, item->getBitOffset(), buttonCount, layout.byteLength);
+      layout.firstButtonIndex = firstUsageID - 1;
       continue;
     }
   }
+  return layout;
+}
+
+MouseReport decodeMouseInputReport(const std::uint8_t* rawReport, const MouseReportLayout& layout) {
+  MouseReport mouseReport;
+  mouseReport.x = extractField(rawReport, layout.x);
+  mouseReport.y = extractField(rawReport, layout.y);
+  mouseReport.wheelVertical = extractField(rawReport, layout.wheelVertical);
+  mouseReport.wheelHorizontal = extractField(rawReport, layout.wheelHorizontal);
+  if (layout.buttons.bitSize != 0) {
+    auto data = extractBitsUnsigned(rawReport, layout.buttons.bitOffset, layout.buttons.bitSize);
+    for (size_t i = 0; i < layout.buttons.bitSize; i++) {
+      mouseReport.isButtonPressed[layout.firstButtonIndex + i] = data & (1 << i);
+    }
+  }
   return mouseReport;
 }
+
+MouseReport decodeMouseInputReport(const std::uint8_t* rawReport, const ReportItemList& inputReportItemList) {
+  return decodeMouseInputReport(rawReport, getMouseReportLayout(inputReportItemList));
+}
+
+bool buildResolutionMultiplierReport(const ReportMap& reportMap, ResolutionMultiplierReport& report) {
+  for (auto& featureReportItemList : reportMap.getFeatureReportItemLists()) {
+    const auto items = featureReportItemList.second->getItems();
+    if (items.empty()) {
+      continue;
+    }
+    auto reportBitLength = items.back()->getBitOffset() + items.back()->getBitLength();
+    std::vector<std::uint8_t> data((reportBitLength + 7) / 8, 0);
+    std::int32_t multiplier = 0;
+    for (auto item : items) {
+      if (item->getUsagePage() != static_cast<usagePage_t>(UsagePage::GENERIC_DESKTOP)) {
+        continue;
+      }
+      const auto& usageIDs = item->getUsageIDs();
+      for (size_t i = 0; i < usageIDs.size() && i < item->getReportCount(); i++) {
+        if (usageIDs[i] != static_cast<usageID_t>(UsageIDGenericDesktop::RESOLUTION_MULTIPLIER)) {
+          continue;
+        }
+        auto bitOffset = item->getBitOffset() + i * item->getReportSize();
+        insertBits(data.data(), bitOffset, item->getReportSize(), item->getLogicalMax());
+        // The effective multiplier is the physical value of the logical maximum. Physical equals logical if not given.
+        auto isPhysicalDefined = item->getPhysicalMin() != 0 || item->getPhysicalMax() != 0;
+        multiplier = std::max(multiplier, isPhysicalDefined ? item->getPhysicalMax() : item->getLogicalMax());
+      }
+    }
+    if (multiplier > 1) {
+      report.reportID = featureReportItemList.first;
+      report.data = data;
+      report.multiplier = multiplier;
+      return true;
+    }
+  }
+  return false;
+}
@@ -15,6 +15,39 @@ class MouseReport {
   std::string toString();
 };
 
+// Location of a field in a mouse input report. A field with bitSize 0 is not present in the report.
+class MouseReportField {
+ public:
+  std::uint32_t bitOffset = 0;
+  std::uint8_t bitSize = 0;
+};
+
+// Field locations of a mouse input report, resolved once per report ID so decoding does not walk the report items.
+class MouseReportLayout {
+ public:
+  MouseReportField x;
+  MouseReportField y;
+  MouseReportField wheelVertical;
+  MouseReportField wheelHorizontal;
+  MouseReportField buttons;  // Bitmap, bit 0 is button firstButtonIndex
+  std::uint8_t firstButtonIndex = 0;
+  std::size_t byteLength = 0;  // Minimum report length which contains all fields
+};
+
+MouseReportLayout getMouseReportLayout(const ReportItemList& inputReportItemList);
+MouseReport decodeMouseInputReport(const std::uint8_t* rawReport, const MouseReportLayout& layout);
 MouseReport decodeMouseInputReport(const std::uint8_t* rawReport, const ReportItemList& inputReportItemList);
 
+// Feature report which sets the HID Resolution Multiplier (Generic Desktop 0x48) of a mouse to its maximum.
+// Once written, wheel and AC Pan values are reported in 1/multiplier detents.
+class ResolutionMultiplierReport {
+ public:
+  reportID_t reportID = 0;
+  std::vector<std::uint8_t> data;
+  std::int32_t multiplier = 1;
+};
+
+// Returns false if the report map has no Resolution Multiplier.
+bool buildResolutionMultiplierReport(const ReportMap& reportMap, ResolutionMultiplierReport& report);
+
 #endif /* E8C27331_0DFE_481C_878A_FAEC7EA8B6B9 */
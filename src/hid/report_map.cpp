@@ -32,13 +32,15 @@ std::uint8_t getReportMapItemSize(reportMapItemPrefix_t prefix) {
 // ReportItem functions
 
 ReportItem::ReportItem(usagePage_t usagePage, std::vector<usageID_t> usageIDs, std::uint32_t reportSize, std::uint32_t reportCount,
-                       std::int32_t logicalMin, std::int32_t logicalMax)
+                       std::int32_t logicalMin, std::int32_t logicalMax, std::int32_t physicalMin, std::int32_t physicalMax)
     : usagePage(usagePage),
       usageIDs(usageIDs),
       reportSize(reportSize),
       reportCount(reportCount),
       logicalMin(logicalMin),
-      logicalMax(logicalMax) {}
+      logicalMax(logicalMax),
+      physicalMin(physicalMin),
+      physicalMax(physicalMax) {}
 
 std::string ReportItem::toString() const {
   std::string usageIDsStr;
@@ -55,6 +57,8 @@ std::uint32_t ReportItem::getReportSize() const { return reportSize; }
 std::uint32_t ReportItem::getReportCount() const { return reportCount; }
 std::int32_t ReportItem::getLogicalMin() const { return logicalMin; }
 std::int32_t ReportItem::getLogicalMax() const { return logicalMax; }
+std::int32_t ReportItem::getPhysicalMin() const { return physicalMin; }
+std::int32_t ReportItem::getPhysicalMax() const { return physicalMax; }
 std::uint32_t ReportItem::getBitOffset() const { return bitOffset; }
 void ReportItem::setBitOffset(std::uint32_t bitOffset) { this->bitOffset = bitOffset; }
 std::uint32_t ReportItem::getBitLength() const { return bitLength; }
@@ -119,180 +123,176 @@ std::string ReportItemList::toString() const {
                      itemsStr);
 }
 
-// ReportMap functions
+// ReportMapParser functions
 
-ReportMap::ReportMap(const std::uint8_t* rawMap, const std::size_t rawMapLen) {
-  class GlobalItemState {
-   public:
-    // some global items are omitted since they are not mandatory
-    usagePage_t usagePage;
-    std::uint8_t reportSize;
-    std::uint8_t reportCount;
-    std::int32_t logicalMin;
-    std::int32_t logicalMax;
-    reportID_t reportID;
-  };
-  class LocalItemState {
-   public:
-    std::vector<usageID_t> usageIDs;
-  };
-  class CollectionProperty {
-   public:
-    usagePage_t usagePage;
-    usageID_t usageID;
-    std::uint8_t collectionType;
-    bool isApplicationCollection() { return collectionType == 0x01; }
-  };
-  GlobalItemState globalItemState;
-  LocalItemState localItemState;
-  std::vector<GlobalItemState> globalItemStateStack;  // only used for PUSH and POP
-  std::vector<CollectionProperty> collectionStack;
-  ReportItemList* itemListInput = nullptr;
-  ReportItemList* itemListOutput = nullptr;
-  ReportItemList* itemListFeature = nullptr;
-
-  // parse the raw report map
-  for (size_t i = 0; i < rawMapLen;) {
-    // read the prefix
-    auto prefix = rawMap[i];
-    auto prefixBase = getReportMapItemPrefixBase(prefix);
-    auto itemType = getReportMapItemType(prefix);
-    auto itemSize = getReportMapItemSize(prefix);
-
-    // read the item value
-    std::uint32_t itemValueUnsigned = 0;
-    std::int32_t itemValueSigned = 0;
-    switch (itemSize) {
-      case 0:
-        break;
-      case 1:
-        std::uint8_t itemValue8;
-        std::memcpy(&itemValue8, rawMap + i + 1, 1);
-        itemValueUnsigned = itemValue8;
-        itemValueSigned = std::int8_t(itemValue8);
-        break;
-      case 2:
-        std::uint16_t itemValue16;
-        std::memcpy(&itemValue16, rawMap + i + 1, 2);
-        itemValueUnsigned = itemValue16;
-        itemValueSigned = std::int16_t(itemValue16);
-        break;
-      case 4:
-        std::uint32_t itemValue32;
-        std::memcpy(&itemValue32, rawMap + i + 1, 4);
-        itemValueUnsigned = itemValue32;
-        itemValueSigned = std::int32_t(itemValue32);
-        break;
+ReportMapParser::ReportMapParser(ReportMap& reportMap) : reportMap(reportMap) {}
+
+void ReportMapParser::feed(const std::uint8_t* data, std::size_t length) {
+  // An item may be split between chunks, so its bytes are collected until it is complete.
+  for (std::size_t i = 0; i < length; i++) {
+    pendingItem[pendingItemLength++] = data[i];
+    if (pendingItemLength == 1U + getReportMapItemSize(pendingItem[0])) {
+      handleItem(pendingItem[0], pendingItem + 1);
+      pendingItemLength = 0;
     }
+  }
+}
 
-    // handle the item
-    switch (prefixBase) {
-      // Main items
-      case ReportMapItemPrefixBase::COLLECTION: {
-        usagePage_t usagePage = globalItemState.usagePage;
-        usageID_t usageID = localItemState.usageIDs.size() > 0 ? localItemState.usageIDs.back() : 0;
-        auto collectionType = (std::uint8_t)itemValueUnsigned;
-        auto collectionProperty = CollectionProperty{usagePage, usageID, collectionType};
-        collectionStack.push_back(collectionProperty);
-        if (collectionProperty.isApplicationCollection()) {
-          itemListInput =
-              new ReportItemList(collectionProperty.usagePage, collectionProperty.usageID, ReportItemList::ReportType::INPUT_TYPE, 0);
-          itemListOutput =
-              new ReportItemList(collectionProperty.usagePage, collectionProperty.usageID, ReportItemList::ReportType::OUTPUT_TYPE, 0);
-          itemListFeature =
-              new ReportItemList(collectionProperty.usagePage, collectionProperty.usageID, ReportItemList::ReportType::FEATURE_TYPE, 0);
-        }
-        break;
-      }
+bool ReportMapParser::isAtItemBoundary() const { return pendingItemLength == 0; }
 
-      case ReportMapItemPrefixBase::END_COLLECTION: {
-        auto collectionProperty = collectionStack.back();
-        collectionStack.pop_back();
-        if (collectionProperty.isApplicationCollection()) {
-          itemListInput->setReportID(globalItemState.reportID);
-          itemListOutput->setReportID(globalItemState.reportID);
-          itemListFeature->setReportID(globalItemState.reportID);
-          addItemList(itemListInput);
-          addItemList(itemListOutput);
-          addItemList(itemListFeature);
-        }
-        break;
-      }
+void ReportMapParser::handleItem(reportMapItemPrefix_t prefix, const std::uint8_t* value) {
+  auto prefixBase = getReportMapItemPrefixBase(prefix);
+  auto itemType = getReportMapItemType(prefix);
+  auto itemSize = getReportMapItemSize(prefix);
+
+  // read the item value
+  std::uint32_t itemValueUnsigned = 0;
+  std::int32_t itemValueSigned = 0;
+  switch (itemSize) {
+    case 0:
+      break;
+    case 1:
+      std::uint8_t itemValue8;
+      std::memcpy(&itemValue8, value, 1);
+      itemValueUnsigned = itemValue8;
+      itemValueSigned = std::int8_t(itemValue8);
+      break;
+    case 2:
+      std::uint16_t itemValue16;
+      std::memcpy(&itemValue16, value, 2);
+      itemValueUnsigned = itemValue16;
+      itemValueSigned = std::int16_t(itemValue16);
+      break;
+    case 4:
+      std::uint32_t itemValue32;
+      std::memcpy(&itemValue32, value, 4);
+      itemValueUnsigned = itemValue32;
+      itemValueSigned = std::int32_t(itemValue32);
+      break;
+  }
 
-      case ReportMapItemPrefixBase::INPUT_:
-        if (itemListInput != nullptr) {
-          auto reportItem = new ReportItem(globalItemState.usagePage, localItemState.usageIDs, globalItemState.reportSize,
-                                           globalItemState.reportCount, globalItemState.logicalMin, globalItemState.logicalMax);
-          itemListInput->addItem(reportItem);
-        }
-        break;
-
-      case ReportMapItemPrefixBase::OUTPUT_:
-        if (itemListOutput != nullptr) {
-          auto reportItem = new ReportItem(globalItemState.usagePage, localItemState.usageIDs, globalItemState.reportSize,
-                                           globalItemState.reportCount, globalItemState.logicalMin, globalItemState.logicalMax);
-          itemListOutput->addItem(reportItem);
-        }
-        break;
-
-      case ReportMapItemPrefixBase::FEATURE:
-        if (itemListFeature != nullptr) {
-          auto reportItem = new ReportItem(globalItemState.usagePage, localItemState.usageIDs, globalItemState.reportSize,
-                                           globalItemState.reportCount, globalItemState.logicalMin, globalItemState.logicalMax);
-          itemListFeature->addItem(reportItem);
-        }
-        break;
-
-      // Global items
-      case ReportMapItemPrefixBase::USAGE_PAGE:
-        globalItemState.usagePage = itemValueUnsigned;
-        break;
-      case ReportMapItemPrefixBase::REPORT_SIZE:
-        globalItemState.reportSize = itemValueUnsigned;
-        break;
-      case ReportMapItemPrefixBase::REPORT_COUNT:
-        globalItemState.reportCount = itemValueUnsigned;
-        break;
-      case ReportMapItemPrefixBase::LOGICAL_MIN:
-        globalItemState.logicalMin = itemValueSigned;
-        break;
-      case ReportMapItemPrefixBase::LOGICAL_MAX:
-        globalItemState.logicalMax = itemValueSigned;
-        break;
-      case ReportMapItemPrefixBase::REPORT_ID:
-        globalItemState.reportID = itemValueUnsigned;
-        break;
-      case ReportMapItemPrefixBase::PUSH:
-        globalItemStateStack.push_back(globalItemState);
-        break;
-      case ReportMapItemPrefixBase::POP:
-        globalItemState = globalItemStateStack.back();
-        globalItemStateStack.pop_back();
-        break;
-
-      // Local items
-      case ReportMapItemPrefixBase::USAGE:
-      case ReportMapItemPrefixBase::USAGE_MIN:
-        localItemState.usageIDs.push_back(itemValueUnsigned);
-        break;
-      case ReportMapItemPrefixBase::USAGE_MAX:
-        // add all usageIDs between USAGE_MIN and USAGE_MAX
-        for (auto usageID = localItemState.usageIDs.back() + 1; usageID <= itemValueUnsigned; usageID++) {
-          localItemState.usageIDs.push_back(usageID);
-        }
-        break;
+  // handle the item
+  switch (prefixBase) {
+    // Main items
+    case ReportMapItemPrefixBase::COLLECTION: {
+      usagePage_t usagePage = globalItemState.usagePage;
+      usageID_t usageID = localItemState.usageIDs.size() > 0 ? localItemState.usageIDs.back() : 0;
+      auto collectionType = (std::uint8_t)itemValueUnsigned;
+      auto collectionProperty = CollectionProperty{usagePage, usageID, collectionType};
+      collectionStack.push_back(collectionProperty);
+      if (collectionProperty.isApplicationCollection()) {
+        itemListInput =
+            new ReportItemList(collectionProperty.usagePage, collectionProperty.usageID, ReportItemList::ReportType::INPUT_TYPE, 0);
+        itemListOutput =
+            new ReportItemList(collectionProperty.usagePage, collectionProperty.usageID, ReportItemList::ReportType::OUTPUT_TYPE, 0);
+        itemListFeature =
+            new ReportItemList(collectionProperty.usagePage, collectionProperty.usageID, ReportItemList::ReportType::FEATURE_TYPE, 0);
+      }
+      break;
     }
 
-    // if main item is found, clear the local item state
-    if (itemType == ReportMapItemPrefixType::MAIN) {
-      localItemState.usageIDs.clear();
+    case ReportMapItemPrefixBase::END_COLLECTION: {
+      auto collectionProperty = collectionStack.back();
+      collectionStack.pop_back();
+      if (collectionProperty.isApplicationCollection()) {
+        itemListInput->setReportID(globalItemState.reportID);
+        itemListOutput->setReportID(globalItemState.reportID);
+        itemListFeature->setReportID(globalItemState.reportID);
+        reportMap.addItemList(itemListInput);
+        reportMap.addItemList(itemListOutput);
+        reportMap.addItemList(itemListFeature);
+      }
+      break;
     }
 
-    // seek to the next item
-    i += 1 + itemSize;
+    case ReportMapItemPrefixBase::INPUT_:
+      if (itemListInput != nullptr) {
+        auto reportItem = new ReportItem(globalItemState.usagePage, localItemState.usageIDs, globalItemState.reportSize,
+                                         globalItemState.reportCount, globalItemState.logicalMin, globalItemState.logicalMax,
+                                         globalItemState.physicalMin, globalItemState.physicalMax);
+        itemListInput->addItem(reportItem);
+      }
+      break;
+
+    case ReportMapItemPrefixBase::OUTPUT_:
+      if (itemListOutput != nullptr) {
+        auto reportItem = new ReportItem(globalItemState.usagePage, localItemState.usageIDs, globalItemState.reportSize,
+                                         globalItemState.reportCount, globalItemState.logicalMin, globalItemState.logicalMax,
+                                         globalItemState.physicalMin, globalItemState.physicalMax);
+        itemListOutput->addItem(reportItem);
+      }
+      break;
+
+    case ReportMapItemPrefixBase::FEATURE:
+      if (itemListFeature != nullptr) {
+        auto reportItem = new ReportItem(globalItemState.usagePage, localItemState.usageIDs, globalItemState.reportSize,
+                                         globalItemState.reportCount, globalItemState.logicalMin, globalItemState.logicalMax,
+                                         globalItemState.physicalMin, globalItemState.physicalMax);
+        itemListFeature->addItem(reportItem);
+      }
+      break;
+
+    // Global items
+    case ReportMapItemPrefixBase::USAGE_PAGE:
+      globalItemState.usagePage = itemValueUnsigned;
+      break;
+    case ReportMapItemPrefixBase::REPORT_SIZE:
+      globalItemState.reportSize = itemValueUnsigned;
+      break;
+    case ReportMapItemPrefixBase::REPORT_COUNT:
+      globalItemState.reportCount = itemValueUnsigned;
+      break;
+    case ReportMapItemPrefixBase::LOGICAL_MIN:
+      globalItemState.logicalMin = itemValueSigned;
+      break;
+    case ReportMapItemPrefixBase::LOGICAL_MAX:
+      globalItemState.logicalMax = itemValueSigned;
+      break;
+    case ReportMapItemPrefixBase::PHYSICAL_MIN:
+      globalItemState.physicalMin = itemValueSigned;
+      break;
+    case ReportMapItemPrefixBase::PHYSICAL_MAX:
+      globalItemState.physicalMax = itemValueSigned;
+      break;
+    case ReportMapItemPrefixBase::REPORT_ID:
+      globalItemState.reportID = itemValueUnsigned;
+      break;
+    case ReportMapItemPrefixBase::PUSH:
+      globalItemStateStack.push_back(globalItemState);
+      break;
+    case ReportMapItemPrefixBase::POP:
+      globalItemState = globalItemStateStack.back();
+      globalItemStateStack.pop_back();
+      break;
+
+    // Local items
+    case ReportMapItemPrefixBase::USAGE:
+    case ReportMapItemPrefixBase::USAGE_MIN:
+      localItemState.usageIDs.push_back(itemValueUnsigned);
+      break;
+    case ReportMapItemPrefixBase::USAGE_MAX:
+      // add all usageIDs between USAGE_MIN and USAGE_MAX
+      for (std::uint32_t usageID = localItemState.usageIDs.back() + 1U; usageID <= itemValueUnsigned; usageID++) {
+        localItemState.usageIDs.push_back(usageID);
+      }
+      break;
+  }
+
+  // if main item is found, clear the local item state
+  if (itemType == ReportMapItemPrefixType::MAIN) {
+    localItemState.usageIDs.clear();
   }
 }
 
+// ReportMap functions
+
+ReportMap::ReportMap() {}
+
+ReportMap::ReportMap(const std::uint8_t* rawMap, const std::size_t rawMapLen) {
+  ReportMapParser parser(*this);
+  parser.feed(rawMap, rawMapLen);
+}
+
 ReportMap::~ReportMap() {
   for (auto itemList : input) {
     delete itemList.second;
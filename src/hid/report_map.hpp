@@ -2,6 +2,7 @@
 #define D81310A6_C4D4_4BD1_A83E_DB6CD32E413C
 
 #include <cstdint>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -70,19 +71,23 @@ class ReportItem {
   std::uint32_t reportCount;
   std::int32_t logicalMin;
   std::int32_t logicalMax;
+  std::int32_t physicalMin;
+  std::int32_t physicalMax;
   // these are generated from the reportSize and reportCount
   std::uint32_t bitOffset = 0;
   std::uint32_t bitLength = 0;
 
  public:
   ReportItem(usagePage_t usagePage, std::vector<usageID_t> usageIDs, std::uint32_t reportSize, std::uint32_t reportCount,
-             std::int32_t logicalMin, std::int32_t logicalMax);
+             std::int32_t logicalMin, std::int32_t logicalMax, std::int32_t physicalMin = 0, std::int32_t physicalMax = 0);
   usagePage_t getUsagePage() const;
   const std::vector<usageID_t>& getUsageIDs() const;
   std::uint32_t getReportSize() const;
   std::uint32_t getReportCount() const;
   std::int32_t getLogicalMin() const;
   std::int32_t getLogicalMax() const;
+  std::int32_t getPhysicalMin() const;
+  std::int32_t getPhysicalMax() const;
   std::uint32_t getBitOffset() const;
   void setBitOffset(std::uint32_t bitOffset);
   std::uint32_t getBitLength() const;
@@ -122,6 +127,56 @@ ReportMapItemPrefixBase getReportMapItemPrefixBase(reportMapItemPrefix_t prefix)
 ReportMapItemPrefixType getReportMapItemType(reportMapItemPrefix_t prefix);
 std::uint8_t getReportMapItemSize(reportMapItemPrefix_t prefix);
 
+class ReportMap;
+
+// Parses a report map into a ReportMap as its bytes arrive, e.g. chunk by chunk during a long GATT read.
+// Chunks may be split anywhere, also within an item.
+class ReportMapParser {
+ private:
+  class GlobalItemState {
+   public:
+    // some global items are omitted since they are not mandatory
+    usagePage_t usagePage;
+    std::uint8_t reportSize;
+    std::uint8_t reportCount;
+    std::int32_t logicalMin;
+    std::int32_t logicalMax;
+    std::int32_t physicalMin = 0;
+    std::int32_t physicalMax = 0;
+    reportID_t reportID;
+  };
+  class LocalItemState {
+   public:
+    std::vector<usageID_t> usageIDs;
+  };
+  class CollectionProperty {
+   public:
+    usagePage_t usagePage;
+    usageID_t usageID;
+    std::uint8_t collectionType;
+    bool isApplicationCollection() { return collectionType == 0x01; }
+  };
+
+  ReportMap& reportMap;
+  GlobalItemState globalItemState;
+  LocalItemState localItemState;
+  std::vector<GlobalItemState> globalItemStateStack;  // only used for PUSH and POP
+  std::vector<CollectionProperty> collectionStack;
+  ReportItemList* itemListInput = nullptr;
+  ReportItemList* itemListOutput = nullptr;
+  ReportItemList* itemListFeature = nullptr;
+  std::uint8_t pendingItem[5];  // prefix and up to 4 bytes of value
+  std::size_t pendingItemLength = 0;
+
+  void handleItem(reportMapItemPrefix_t prefix, const std::uint8_t* value);
+
+ public:
+  explicit ReportMapParser(ReportMap& reportMap);
+  void feed(const std::uint8_t* data, std::size_t length);
+  // false if the data fed so far ends within an item
+  bool isAtItemBoundary() const;
+};
+
 class ReportMap {
  private:
   std::unordered_map<reportID_t, ReportItemList*> input;
@@ -131,6 +186,8 @@ class ReportMap {
  public:
   void addItemList(ReportItemList* itemList);
 
+  // Empty map to be filled by a ReportMapParser.
+  ReportMap();
   ReportMap(const std::uint8_t* rawMap, const std::size_t rawMapLen);
   ~ReportMap();
   const ReportItemList* getInputReportItemList(reportID_t reportID) const;
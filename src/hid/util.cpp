@@ -1,39 +1,46 @@
 #include "util.hpp"
 
 // Function to get value from byte array.
-std::uint32_t extractBitsUnsigned(const std::uint8_t* array, std::uint8_t bitOffset, std::uint8_t bitSize) {
-  std::uint32_t result = 0;
-  std::uint8_t bitIdx = 0;
-  std::uint8_t byteIdx = bitOffset / 8;
-  std::uint8_t bitIdxInByte = bitOffset % 8;
-  while (bitIdx < bitSize) {
-    // Extract current byte
-    std::uint8_t byte = array[byteIdx];
-    // Extract bits from current byte
-    while (bitIdxInByte < 8 && bitIdx < bitSize) {
-      if (byte & (1 << bitIdxInByte)) {
-        result |= (1 << bitIdx);
-      }
-      // Move to next bit
-      bitIdx++;
-      bitIdxInByte++;
-    }
-    // Move to next byte
-    byteIdx++;
-    bitIdxInByte = 0;
+// Only the bytes covering the field are read, at most 5 for a 32-bit field.
+std::uint32_t extractBitsUnsigned(const std::uint8_t* array, std::uint32_t bitOffset, std::uint8_t bitSize) {
+  if (bitSize == 0) {
+    return 0;
   }
-  return result;
+  const auto firstByteIdx = bitOffset / 8;
+  const auto lastByteIdx = (bitOffset + bitSize - 1) / 8;
+  std::uint64_t bits = 0;
+  for (auto byteIdx = lastByteIdx + 1; byteIdx-- > firstByteIdx;) {
+    bits = (bits << 8) | array[byteIdx];
+  }
+  bits >>= bitOffset % 8;
+  if (bitSize < 32) {
+    bits &= (std::uint64_t(1) << bitSize) - 1;
+  }
+  return static_cast<std::uint32_t>(bits);
 }
 
 // Function to get value from byte array, signed version.
-std::int32_t extractBitsSigned(const std::uint8_t* array, std::uint8_t bitOffset, std::uint8_t bitSize) {
+std::int32_t extractBitsSigned(const std::uint8_t* array, std::uint32_t bitOffset, std::uint8_t bitSize) {
   std::int32_t result = 0;
   std::uint32_t unsignedResult = extractBitsUnsigned(array, bitOffset, bitSize);
   bool isNegative = unsignedResult & (1 << (bitSize - 1));
-  if (isNegative) {
+  if (isNegative && bitSize < 32) {
     // Set all bits after bitSize to 1
     unsignedResult |= (0xFFFFFFFF << bitSize);
   }
   result = unsignedResult;  // If variables are the same size, they are copied bit by bit as is.
   return result;
 }
+
+// Function to write value into byte array. Bits outside the field are left untouched.
+void insertBits(std::uint8_t* array, std::uint32_t bitOffset, std::uint8_t bitSize, std::uint32_t value) {
+  for (std::uint8_t bitIdx = 0; bitIdx < bitSize; bitIdx++) {
+    auto byteIdx = (bitOffset + bitIdx) / 8;
+    auto bitIdxInByte = (bitOffset + bitIdx) % 8;
+    if (value & (1 << bitIdx)) {
+      array[byteIdx] |= (1 << bitIdxInByte);
+    } else {
+      array[byteIdx] &= ~(1 << bitIdxInByte);
+    }
+  }
+}
@@ -0,0 +1,69 @@
+#include "link_phase.hpp"
+
+namespace {
+
+// Division rounding toward negative infinity.
+std::int64_t floorDiv(std::int64_t a, std::int64_t b) {
+  auto q = a / b;
+  return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+}  // namespace
+
+void LinkPhaseEstimator::updateInterval(std::int64_t gapMicros) {
+  if (intervalMicros == 0) {
+    intervalMicros = gapMicros;
+    return;
+  }
+  // Gaps of several intervals are skipped connection events, unless they persist after a parameter update.
+  if (gapMicros >= intervalMicros * 3 / 2) {
+    if (++longGapCount >= INTERVAL_RESET_COUNT) {
+      intervalMicros = gapMicros;
+      longGapCount = 0;
+    }
+    return;
+  }
+  longGapCount = 0;
+  intervalMicros += (gapMicros - intervalMicros) / 8;
+}
+
+void LinkPhaseEstimator::addArrival(std::int64_t timeMicros) {
+  auto isFirstArrival = lastArrivalMicros == 0;
+  auto isSameEvent = !isFirstArrival && timeMicros - lastArrivalMicros < BURST_GAP_MICROS;
+  lastArrivalMicros = timeMicros;
+  if (isSameEvent) {
+    return;  // Later notifications of a burst are delayed by the ones before them
+  }
+  if (!isFirstArrival) {
+    updateInterval(timeMicros - lastEventMicros);
+  }
+  lastEventMicros = timeMicros;
+  if (anchorMicros == 0 || intervalMicros == 0) {
+    anchorMicros = timeMicros;
+    return;
+  }
+  // Move the anchor a quarter of the way toward the observed event, which filters out host-side scheduling jitter.
+  auto events = floorDiv(timeMicros - anchorMicros + intervalMicros / 2, intervalMicros);
+  auto predictedMicros = anchorMicros + events * intervalMicros;
+  anchorMicros = predictedMicros + (timeMicros - predictedMicros) / 4;
+}
+
+bool LinkPhaseEstimator::isLocked() const { return intervalMicros != 0 && anchorMicros != 0; }
+
+std::int64_t LinkPhaseEstimator::getIntervalMicros() const { return intervalMicros; }
+
+std::int64_t LinkPhaseEstimator::getAnchorMicros() const { return anchorMicros; }
+
+std::int64_t alignToLinkPhase(std::int64_t nominalMicros, std::int64_t packetIntervalMicros, std::int64_t anchorMicros,
+                              std::int64_t linkIntervalMicros, std::int64_t guardMicros) {
+  if (linkIntervalMicros <= 0 || linkIntervalMicros > packetIntervalMicros || anchorMicros == 0) {
+    return nominalMicros;
+  }
+  // Number of the first event whose guarded time is not before nominalMicros, rounded up.
+  auto events = -floorDiv(anchorMicros + guardMicros - nominalMicros, linkIntervalMicros);
+  auto alignedMicros = anchorMicros + events * linkIntervalMicros + guardMicros;
+  if (alignedMicros - nominalMicros > packetIntervalMicros / 4) {
+    return nominalMicros;
+  }
+  return alignedMicros;
+}
@@ -0,0 +1,37 @@
+#ifndef AE215B29_9620_47F7_99EA_1B3A8EEC90EC
+#define AE215B29_9620_47F7_99EA_1B3A8EEC90EC
+
+#include <cstdint>
+
+// Estimates the connection-event timing of a BLE link from the arrival times of its notifications.
+// Notifications arrive in bursts at connection-event boundaries, so the first arrival of each burst marks an event.
+class LinkPhaseEstimator {
+ public:
+  static constexpr std::int64_t BURST_GAP_MICROS = 1000;  // Arrivals closer than this belong to the same connection event
+  static constexpr int INTERVAL_RESET_COUNT = 8;          // Consecutive longer gaps after which the interval is re-learned
+
+ private:
+  std::int64_t intervalMicros = 0;
+  std::int64_t anchorMicros = 0;  // Estimated time of a recent connection event
+  std::int64_t lastArrivalMicros = 0;
+  std::int64_t lastEventMicros = 0;  // First arrival of the latest burst
+  int longGapCount = 0;
+
+  void updateInterval(std::int64_t gapMicros);
+
+ public:
+  void addArrival(std::int64_t timeMicros);
+  bool isLocked() const;
+  std::int64_t getIntervalMicros() const;
+  std::int64_t getAnchorMicros() const;
+};
+
+// Returns the time to send a packet nominally due at nominalMicros, packetIntervalMicros after the previous one:
+// guardMicros after the first predicted connection event at or after it, or nominalMicros itself if that would delay the
+// packet by more than a quarter of the packet interval. Packets are only delayed, never sent early, so the rate the host
+// set is kept. A link whose connection interval is longer than the packet interval is not aligned: its input arrives less
+// often than packets may be sent, so it goes out on arrival, and moving the slot could only delay it.
+std::int64_t alignToLinkPhase(std::int64_t nominalMicros, std::int64_t packetIntervalMicros, std::int64_t anchorMicros,
+                              std::int64_t linkIntervalMicros, std::int64_t guardMicros);
+
+#endif /* AE215B29_9620_47F7_99EA_1B3A8EEC90EC */
@@ -23,7 +23,7 @@
 #endif
 
 #ifndef PS2BLE_LOG_TASK_CORE
-#define PS2BLE_LOG_TASK_CORE APP_CPU_NUM
+#define PS2BLE_LOG_TASK_CORE PRO_CPU_NUM  // Off the PS/2 core, see task_plan.hpp
 #endif
 
 #ifndef PS2BLE_LOG_QUEUE_SIZE
@@ -1,19 +1,35 @@
 // clang-format off
 #include <fmt/core.h>
-#include <boost/circular_buffer.hpp>
 #include <Arduino.h>
 #include <NimBLEDevice.h>
 // clang-format on
 
+#include <atomic>
 #include <cstdio>
+#include <functional>
 #include <map>
-
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+#include "conn_params_policy.hpp"
+#include "connect_candidates.hpp"
+#include "connection_slots.hpp"
+#include "digitizer_tracker.hpp"
+#include "gatt_cache.hpp"
+#include "hid/digitizer.hpp"
 #include "hid/keyboard.hpp"
 #include "hid/mouse.hpp"
 #include "hid/report_map.hpp"
 #include "key_translate.hpp"
+#include "link_phase.hpp"
 #include "logging.hpp"
+#include "mouse_sender.hpp"
+#include "mouse_transform.hpp"
+#include "ps2dev_port.hpp"
+#include "scan_scheduler.hpp"
 #include "secrets.hpp"
+#include "task_plan.hpp"
 extern "C" {
 #include <esp_hid_common.h>
 }
@@ -29,8 +45,11 @@ extern "C" {
 #include <PS2Mouse.hpp>
 
 AsyncWebServer server(80);
-esp32_ps2dev::PS2Mouse mouse(17, 16);
-esp32_ps2dev::PS2Keyboard keyboard(19, 18);
+MonitoredPs2Mouse mouse(17, 16);
+MonitoredPs2Keyboard keyboard(19, 18);
+Ps2devMousePort mousePort(mouse);
+Ps2devKeyboardPort keyboardPort(keyboard);
+Ps2MouseSender mouseSender(mousePort);
 
 const char CUUID_HID_SERVICE[] = "1812";
 const char CUUID_HID_INFORMATION[] = "2A4A";
@@ -39,27 +58,78 @@ const char CUUID_HID_CONTROL_POINT[] = "2A4C";
 const char CUUID_HID_REPORT_DATA[] = "2A4D";
 const char DUUID_HID_REPORT_REFERENCE[] = "2908";
 
+// ATT MTU requested from each device. 247 fills one link layer packet with the LE Data Length Extension, so a report map
+// of a few hundred bytes is read in one or two round trips instead of a chain of 22-byte Read Blob responses.
+#ifndef PS2BLE_BLE_MTU
+#define PS2BLE_BLE_MTU 247
+#endif
+
 enum class ScanMode : uint8_t {
   NewDeviceOnly,
   NewDeviceAndBoundedDevice,
   BoundedDeviceOnly,
   Disabled,
+  AutoConnect,  // taskConnect tries each disconnected bonded device once, then the scan works like BoundedDeviceOnly
   _Count,
 };
 
 bool isValidScanMode(uint8_t scanMode) { return scanMode < static_cast<uint8_t>(ScanMode::_Count); }
 
-constexpr auto DEFAULT_SCAN_MODE = ScanMode::BoundedDeviceOnly;
-
-QueueHandle_t xQueueScanMode;
-QueueHandle_t xQueueDeviceToConnect;
+// Reconnect bonded devices with AutoConnect instead of BoundedDeviceOnly after boot and pairing.
+#ifndef PS2BLE_AUTO_CONNECT
+#define PS2BLE_AUTO_CONNECT 0
+#endif
+
+// Time the controller waits for one device in AutoConnect before it moves on to the next, in seconds.
+#ifndef PS2BLE_AUTO_CONNECT_TIMEOUT
+#define PS2BLE_AUTO_CONNECT_TIMEOUT 1
+#endif
+
+constexpr auto DEFAULT_SCAN_MODE = PS2BLE_AUTO_CONNECT ? ScanMode::AutoConnect : ScanMode::BoundedDeviceOnly;
+
+// Events which make taskScan re-evaluate the scan. It blocks on them, so it reacts at once and does not poll while idle.
+constexpr EventBits_t SCAN_EVENT_MODE_CHANGED = 1 << 0;
+constexpr EventBits_t SCAN_EVENT_PAUSE_CHANGED = 1 << 1;
+constexpr EventBits_t SCAN_EVENT_SCAN_COMPLETE = 1 << 2;
+constexpr EventBits_t SCAN_EVENT_LINKS_CHANGED = 1 << 3;  // A bonded device connected or disconnected, or a bond changed
+constexpr EventBits_t SCAN_EVENT_ALL =
+    SCAN_EVENT_MODE_CHANGED | SCAN_EVENT_PAUSE_CHANGED | SCAN_EVENT_SCAN_COMPLETE | SCAN_EVENT_LINKS_CHANGED;
+constexpr TickType_t SCAN_START_RETRY_TICKS = pdMS_TO_TICKS(100);  // After the controller refused to start scanning
+
+EventGroupHandle_t xEventGroupScan;
+std::atomic<ScanMode> CurrentScanMode{DEFAULT_SCAN_MODE};  // Chosen by the user
+std::atomic<bool> isScanPaused{false};                     // Set by taskConnect while the controller initiates a connection
+// AutoConnect runs a round of direct connection attempts after boot, a mode change and each lost link. The scan stays
+// off during a round.
+std::atomic<bool> isAutoConnectRequested{false};
+std::atomic<bool> isAutoConnectRoundActive{false};
+ConnectCandidateTable ConnectCandidates;
+TaskHandle_t taskConnectHandle;
 QueueHandle_t xQueueLastConnectedDevice;
-
-using HandleReportIDMap = std::map<uint16_t, reportID_t>;
-std::map<NimBLEAddress, HandleReportIDMap> HandleReportIDMapCache;
-std::map<NimBLEAddress, ReportMap*> ReportMapCache;
-
-void subscribeToHIDService(NimBLEClient* client);
+SemaphoreHandle_t xSemaphoreLinkDisconnected;  // Given on every disconnection, taken by taskConnect after evicting a link
+
+std::map<NimBLEAddress, HandleReportReferenceMap> ReportReferenceCache;
+// Shared, so a report map dropped by invalidateGattCache stays alive while a setup task or a callback still uses it.
+std::map<NimBLEAddress, std::shared_ptr<ReportMap>> ReportMapCache;
+// Guards the caches, which the connection setup tasks change concurrently for different devices while the notify
+// callbacks look them up. Lookups use find(), so a device whose cache was dropped is not inserted again.
+std::mutex GattCacheMutex;
+
+class ConnectionSetupTimer;
+void setUpConnection(NimBLEClient* client, ConnectionSetupTimer& timer);
+bool isGattCacheValid(const NimBLEAddress& addr);
+void invalidateGattCache(const NimBLEAddress& addr);
+void releaseMouseButtons(const NimBLEAddress& addr);
+bool hasPointerReports(const NimBLEAddress& addr);
+void removeLinkState(const NimBLEAddress& addr);
+int getConnectedBondedCount();
+void rebuildBondedAddresses();
+ConnParams getConnParams(const NimBLEAddress& addr);
+void eraseConnParams(const NimBLEAddress& addr);
+void rebalanceConnParams();
+void eraseLinkActivity(const NimBLEAddress& addr);
+bool runBleCommand(const std::function<void()>& run, TickType_t timeout);
+bool postBleCommand(const std::function<void()>& run);
 
 std::string stripColon(const std::string& str) {
   auto output = std::string();
@@ -80,18 +150,24 @@ class ClientCallbacks : public NimBLEClientCallbacks {
   void onDisconnect(NimBLEClient* pClient) {
     auto output = fmt::format("Disconnected from: {}", pClient->getPeerAddress().toString());
     PS2BLE_LOGI(output);
+    releaseMouseButtons(pClient->getPeerAddress());
+    removeLinkState(pClient->getPeerAddress());
+    eraseConnParams(pClient->getPeerAddress());
+    eraseLinkActivity(pClient->getPeerAddress());
+    rebalanceConnParams();
+    xSemaphoreGive(xSemaphoreLinkDisconnected);
   };
 
   bool onConnParamsUpdateRequest(NimBLEClient* pClient, const ble_gap_upd_params* params) {
-    auto reject = false;
-    if (params->itvl_min < 12) {  // 12 * 1.25ms = 15ms
-      reject = true;
-    }
+    auto policy = getConnParams(pClient->getPeerAddress());
+    auto reject = !ConnParamsPolicy::isAcceptable(policy, params->itvl_min, params->itvl_max, params->latency);
 
     if (reject) {
       PS2BLE_LOGI(fmt::format(
-          "Rejected connection parameters update request from: {}, itvl_min: {}, itvl_max: {}, latency: {}, supervision_timeout: {}",
-          pClient->getPeerAddress().toString(), params->itvl_min, params->itvl_max, params->latency, params->supervision_timeout));
+          "Rejected connection parameters update request from: {}, itvl_min: {}, itvl_max: {}, latency: {}, supervision_timeout: {}, "
+          "accepted interval: {}-{}",
+          pClient->getPeerAddress().toString(), params->itvl_min, params->itvl_max, params->latency, params->supervision_timeout,
+          policy.minInterval, policy.maxAcceptedInterval));
       return false;
     } else {
       PS2BLE_LOGI(fmt::format(
@@ -117,21 +193,84 @@ class ClientCallbacks : public NimBLEClientCallbacks {
     if (!desc->sec_state.encrypted) {
       PS2BLE_LOGW("WARNING: Link is not encrypted");
     }
+    // The host task must not wait for taskBleCommand, which may be waiting for a host event.
+    auto ok = postBleCommand([]() {
+      rebuildBondedAddresses();
+      xEventGroupSetBits(xEventGroupScan, SCAN_EVENT_LINKS_CHANGED);
+    });
+    if (!ok) {
+      PS2BLE_LOGE("Failed to post the bond update to taskBleCommand");
+    }
   };
 };
 
 static ClientCallbacks clientCB;
 
-bool isBondedDevice(NimBLEAdvertisedDevice* advertisedDevice) {
-  auto addr = advertisedDevice->getAddress();
+// Bonded addresses as 48-bit integers. Advertisement filtering runs for every advertisement in the host task, so it
+// looks them up here instead of walking the bond store, which is only read again when the bonds change.
+std::unordered_set<std::uint64_t> BondedAddresses;
+// The same bonds in the order of the bond store, for the tasks which go through all of them.
+std::vector<NimBLEAddress> BondedAddressList;
+std::mutex BondedAddressesMutex;
+
+// The address type is not part of the key, the same as NimBLEAddress comparisons.
+std::uint64_t getAddressKey(const NimBLEAddress& addr) {
+  auto native = addr.getNative();
+  std::uint64_t key = 0;
+  for (auto i = 0; i < 6; i++) {
+    key |= static_cast<std::uint64_t>(native[i]) << (8 * i);
+  }
+  return key;
+}
+
+// Reads the bond store, so it runs on taskBleCommand, except once in setup before the tasks start.
+void rebuildBondedAddresses() {
+  std::unordered_set<std::uint64_t> addresses;
+  std::vector<NimBLEAddress> addressList;
   auto bondedNum = NimBLEDevice::getNumBonds();
   for (size_t i = 0; i < bondedNum; i++) {
-    auto bondedAddr = NimBLEDevice::getBondedAddress(i);
-    if (addr == bondedAddr) {
-      return true;
-    }
+    auto addr = NimBLEDevice::getBondedAddress(i);
+    addresses.insert(getAddressKey(addr));
+    addressList.push_back(addr);
   }
-  return false;
+  std::lock_guard<std::mutex> lock(BondedAddressesMutex);
+  BondedAddresses.swap(addresses);
+  BondedAddressList.swap(addressList);
+}
+
+std::vector<NimBLEAddress> getBondedAddresses() {
+  std::lock_guard<std::mutex> lock(BondedAddressesMutex);
+  return BondedAddressList;
+}
+
+bool isBondedAddress(const NimBLEAddress& addr) {
+  auto key = getAddressKey(addr);
+  std::lock_guard<std::mutex> lock(BondedAddressesMutex);
+  return BondedAddresses.count(key) != 0;
+}
+
+bool isBondedDevice(NimBLEAdvertisedDevice* advertisedDevice) { return isBondedAddress(advertisedDevice->getAddress()); }
+
+// Called from the scan callbacks in the host task, so it must not block. Returns true for a device not offered before.
+bool offerConnectCandidate(NimBLEAdvertisedDevice* advertisedDevice, bool isBonded) {
+  auto addr = advertisedDevice->getAddress();
+  ConnectCandidate candidate;
+  candidate.address = getAddressKey(addr);
+  candidate.addressType = addr.getType();
+  candidate.rssi = advertisedDevice->getRSSI();
+  candidate.lastSeenMicros = esp_timer_get_time();
+  candidate.isBonded = isBonded;
+  auto isNew = ConnectCandidates.offer(candidate);
+  xTaskNotifyGive(taskConnectHandle);
+  return isNew;
+}
+
+NimBLEAddress getCandidateAddress(const ConnectCandidate& candidate) {
+  std::uint8_t native[6];
+  for (auto i = 0; i < 6; i++) {
+    native[i] = static_cast<std::uint8_t>(candidate.address >> (8 * i));
+  }
+  return NimBLEAddress(native, candidate.addressType);
 }
 
 bool isAdvertisingHIDService(NimBLEAdvertisedDevice* advertisedDevice) {
@@ -145,8 +284,7 @@ class AdvertisedDeviceCallbacksNewDeviceOnly : public NimBLEAdvertisedDeviceCall
   void onResult(NimBLEAdvertisedDevice* advertisedDevice) {
     auto advType = advertisedDevice->getAdvType();
     if (isBondedDevice(advertisedDevice)) return;
-    if (isAdvertisingHIDService(advertisedDevice)) {
-      xQueueSend(xQueueDeviceToConnect, &advertisedDevice, portMAX_DELAY);
+    if (isAdvertisingHIDService(advertisedDevice) && offerConnectCandidate(advertisedDevice, false)) {
       PS2BLE_LOGI("Found new device advertising HID service");
     }
   };
@@ -154,9 +292,9 @@ class AdvertisedDeviceCallbacksNewDeviceOnly : public NimBLEAdvertisedDeviceCall
 
 class AdvertisedDeviceCallbacksNewDeviceAndBoundedDevice : public NimBLEAdvertisedDeviceCallbacks {
   void onResult(NimBLEAdvertisedDevice* advertisedDevice) {
-    if (isBondedDevice(advertisedDevice) || isAdvertisingHIDService(advertisedDevice)) {
-      xQueueSend(xQueueDeviceToConnect, &advertisedDevice, portMAX_DELAY);
-      if (isBondedDevice(advertisedDevice)) {
+    auto isBonded = isBondedDevice(advertisedDevice);
+    if ((isBonded || isAdvertisingHIDService(advertisedDevice)) && offerConnectCandidate(advertisedDevice, isBonded)) {
+      if (isBonded) {
         PS2BLE_LOGI("Found bonded device");
       } else {
         PS2BLE_LOGI("Found new device advertising HID service");
@@ -167,80 +305,134 @@ class AdvertisedDeviceCallbacksNewDeviceAndBoundedDevice : public NimBLEAdvertis
 
 class AdvertisedDeviceCallbacksBoundedDeviceOnly : public NimBLEAdvertisedDeviceCallbacks {
   void onResult(NimBLEAdvertisedDevice* advertisedDevice) {
-    if (isBondedDevice(advertisedDevice)) {
-      xQueueSend(xQueueDeviceToConnect, &advertisedDevice, portMAX_DELAY);
+    if (isBondedDevice(advertisedDevice) && offerConnectCandidate(advertisedDevice, true)) {
       PS2BLE_LOGI("Found bonded device");
     }
   };
 };
 
-void scanCompleteCB(NimBLEScanResults) { PS2BLE_LOGI("Scan complete"); }
+void scanCompleteCB(NimBLEScanResults) {
+  PS2BLE_LOGI("Scan complete");
+  xEventGroupSetBits(xEventGroupScan, SCAN_EVENT_SCAN_COMPLETE);
+}
+
+ScanMode getScanMode() { return CurrentScanMode.load(); }
+
+void setScanMode(ScanMode mode) {
+  CurrentScanMode.store(mode);
+  if (mode == ScanMode::AutoConnect) {
+    isAutoConnectRequested.store(true);
+  }
+  xEventGroupSetBits(xEventGroupScan, SCAN_EVENT_MODE_CHANGED);
+  xTaskNotifyGive(taskConnectHandle);
+}
+
+void setAutoConnectRoundActive(bool isActive) {
+  isAutoConnectRoundActive.store(isActive);
+  xEventGroupSetBits(xEventGroupScan, SCAN_EVENT_MODE_CHANGED);
+}
+
+void setScanPaused(bool isPaused) {
+  isScanPaused.store(isPaused);
+  xEventGroupSetBits(xEventGroupScan, SCAN_EVENT_PAUSE_CHANGED);
+}
 
 void taskScan(void* arg) {
   AdvertisedDeviceCallbacksNewDeviceOnly newDeviceOnlyCallbacks;
   AdvertisedDeviceCallbacksNewDeviceAndBoundedDevice newDeviceAndBoundedDeviceCallbacks;
   AdvertisedDeviceCallbacksBoundedDeviceOnly boundedDeviceOnlyCallbacks;
   NimBLEScan* scan = NimBLEDevice::getScan();
-  scan->setInterval(45);
-  scan->setWindow(15);
   scan->setActiveScan(true);
+  ScanScheduler scheduler;
+  scheduler.reset(esp_timer_get_time());
   ScanMode lastScanMode = DEFAULT_SCAN_MODE;
-  ScanMode scanMode;
+  ScanParams lastParams;
+  auto lastConnectedBondedCount = 0;
+  TickType_t waitTicks = portMAX_DELAY;
 
   while (true) {
-    delay(100);
-    if (xQueuePeek(xQueueScanMode, &scanMode, portMAX_DELAY) == pdTRUE) {
-      if (scanMode == ScanMode::Disabled) {
-        PS2BLE_LOGV("Scan disabled");
-        continue;
-      }
+    xEventGroupWaitBits(xEventGroupScan, SCAN_EVENT_ALL, pdTRUE, pdFALSE, waitTicks);
+    waitTicks = portMAX_DELAY;
+    auto nowMicros = esp_timer_get_time();
+    auto bondedAddresses = getBondedAddresses();
+    auto bondedCount = static_cast<int>(bondedAddresses.size());
+    auto connectedBondedCount = getConnectedBondedCount();
+    if (connectedBondedCount < lastConnectedBondedCount) {
+      PS2BLE_LOGD("Bonded device disconnected, scanning aggressively again");
+      scheduler.reset(nowMicros);
+    }
+    lastConnectedBondedCount = connectedBondedCount;
 
-      if (scan->isScanning()) {
-        if (scanMode == lastScanMode) {
-          PS2BLE_LOGV("Scan mode unchanged");
-          continue;
-        } else {
-          PS2BLE_LOGD("Scan mode changed, stopping scan");
-          scan->stop();
-        }
+    auto scanMode = isScanPaused.load() ? ScanMode::Disabled : getScanMode();
+    if (scanMode == ScanMode::AutoConnect) {
+      scanMode = isAutoConnectRoundActive.load() ? ScanMode::Disabled : ScanMode::BoundedDeviceOnly;
+    }
+    ScanParams params;
+    if (scanMode != ScanMode::Disabled) {
+      auto isPairing = scanMode != ScanMode::BoundedDeviceOnly;
+      params = scheduler.getParams(isPairing, bondedCount, connectedBondedCount, nowMicros);
+      // Wake up when the scheduler backs off to its next step, even if nothing else happens.
+      auto nextChangeMicros = scheduler.getNextChangeMicros(isPairing, bondedCount, connectedBondedCount, nowMicros);
+      if (nextChangeMicros >= 0) {
+        waitTicks = pdMS_TO_TICKS((nextChangeMicros - nowMicros) / 1000) + 1;
       }
-
-      switch (scanMode) {
-        case ScanMode::NewDeviceOnly:
-          PS2BLE_LOGI("Scan mode: NewDeviceOnly");
-          scan->setAdvertisedDeviceCallbacks(&newDeviceOnlyCallbacks);
-          scan->setFilterPolicy(BLE_HCI_SCAN_FILT_NO_WL);
-          break;
-        case ScanMode::NewDeviceAndBoundedDevice:
-          PS2BLE_LOGI("Scan mode: NewDeviceAndBoundedDevice");
-          scan->setAdvertisedDeviceCallbacks(&newDeviceAndBoundedDeviceCallbacks);
-          scan->setFilterPolicy(BLE_HCI_SCAN_FILT_NO_WL);
-          break;
-        case ScanMode::BoundedDeviceOnly:
-          PS2BLE_LOGI("Scan mode: BoundedDeviceOnly");
-          scan->setAdvertisedDeviceCallbacks(&boundedDeviceOnlyCallbacks);
-          scan->setActiveScan(true);
-          for (size_t i = 0; i < NimBLEDevice::getNumBonds(); i++) {
-            const auto& addr = NimBLEDevice::getBondedAddress(i);
-            auto ok = NimBLEDevice::whiteListAdd(addr);
-            if (!ok) {
-              PS2BLE_LOGE(fmt::format("Failed to add {} to whitelist", addr.toString()));
-            }
-          }
-          scan->setFilterPolicy(BLE_HCI_SCAN_FILT_USE_WL);
-          break;
-        default:
-          continue;
+    }
+    if (!params.isEnabled) {
+      PS2BLE_LOGV("Scan disabled");
+      if (scan->isScanning()) {
+        scan->stop();
       }
+      continue;
+    }
 
-      auto ok = scan->start(0, scanCompleteCB);
-      if (!ok) {
-        PS2BLE_LOGV("Failed to start scan");
+    if (scan->isScanning()) {
+      if (scanMode == lastScanMode && params == lastParams) {
+        PS2BLE_LOGV("Scan unchanged");
+        continue;
       } else {
-        lastScanMode = scanMode;
-        PS2BLE_LOGI("Scan started");
+        PS2BLE_LOGD("Scan mode or duty cycle changed, stopping scan");
+        scan->stop();
       }
     }
+
+    switch (scanMode) {
+      case ScanMode::NewDeviceOnly:
+        PS2BLE_LOGI("Scan mode: NewDeviceOnly");
+        scan->setAdvertisedDeviceCallbacks(&newDeviceOnlyCallbacks);
+        scan->setFilterPolicy(BLE_HCI_SCAN_FILT_NO_WL);
+        break;
+      case ScanMode::NewDeviceAndBoundedDevice:
+        PS2BLE_LOGI("Scan mode: NewDeviceAndBoundedDevice");
+        scan->setAdvertisedDeviceCallbacks(&newDeviceAndBoundedDeviceCallbacks);
+        scan->setFilterPolicy(BLE_HCI_SCAN_FILT_NO_WL);
+        break;
+      case ScanMode::BoundedDeviceOnly:
+        PS2BLE_LOGI("Scan mode: BoundedDeviceOnly");
+        scan->setAdvertisedDeviceCallbacks(&boundedDeviceOnlyCallbacks);
+        scan->setActiveScan(true);
+        for (const auto& addr : bondedAddresses) {
+          auto ok = NimBLEDevice::whiteListAdd(addr);
+          if (!ok) {
+            PS2BLE_LOGE(fmt::format("Failed to add {} to whitelist", addr.toString()));
+          }
+        }
+        scan->setFilterPolicy(BLE_HCI_SCAN_FILT_USE_WL);
+        break;
+      default:
+        continue;
+    }
+
+    scan->setInterval(params.intervalMillis);
+    scan->setWindow(params.windowMillis);
+    auto ok = scan->start(0, scanCompleteCB);
+    if (!ok) {
+      PS2BLE_LOGV("Failed to start scan");
+      waitTicks = SCAN_START_RETRY_TICKS;
+    } else {
+      lastScanMode = scanMode;
+      lastParams = params;
+      PS2BLE_LOGI(fmt::format("Scan started, interval: {} ms, window: {} ms", params.intervalMillis, params.windowMillis));
+    }
   }
 }
 
@@ -251,12 +443,7 @@ const std::uint16_t APPEARANCE_GENERIC_HID = 960;
 const std::uint16_t APPEARANCE_HID_KEYBOARD = 961;
 const std::uint16_t APPEARANCE_HID_MOUSE = 962;
 
-std::uint16_t getAppearance(NimBLEClient* client) {
-  auto service = client->getService(NimBLEUUID(SERVICE_UUID_GENERIC_ACCESS));
-  if (service == nullptr) {
-    PS2BLE_LOGE("Generic Access service not found");
-    return 0;
-  }
+std::uint16_t getAppearance(NimBLERemoteService* service) {
   auto characteristic = service->getCharacteristic(NimBLEUUID(CHARACTERISTIC_UUID_APPEARANCE));
   if (characteristic == nullptr) {
     PS2BLE_LOGE("Appearance characteristic not found");
@@ -284,8 +471,8 @@ std::string getAppearanceName(std::uint16_t appearance) {
   }
 }
 
-bool saveAppearanceToNVS(NimBLEClient* client) {
-  auto appearance = getAppearance(client);
+bool saveAppearanceToNVS(NimBLEClient* client, NimBLERemoteService* service) {
+  auto appearance = getAppearance(service);
   if (appearance == 0) {
     PS2BLE_LOGE("Failed to get appearance");
     return false;
@@ -311,12 +498,7 @@ std::uint16_t readAppearanceFromNVS(const NimBLEAddress& addr) {
   return appearance;
 }
 
-std::string getDeviceName(NimBLEClient* client) {
-  auto service = client->getService(NimBLEUUID(SERVICE_UUID_GENERIC_ACCESS));
-  if (service == nullptr) {
-    PS2BLE_LOGE("Generic Access service not found");
-    return "";
-  }
+std::string getDeviceName(NimBLERemoteService* service) {
   auto characteristic = service->getCharacteristic(NimBLEUUID(CHARACTERISTIC_UUID_DEVICE_NAME));
   if (characteristic == nullptr) {
     PS2BLE_LOGE("Device Name characteristic not found");
@@ -327,8 +509,8 @@ std::string getDeviceName(NimBLEClient* client) {
   return deviceName;
 }
 
-bool saveDeviceNameToNVS(NimBLEClient* client) {
-  auto name = getDeviceName(client);
+bool saveDeviceNameToNVS(NimBLEClient* client, NimBLERemoteService* service) {
+  auto name = getDeviceName(service);
   if (name == "") {
     PS2BLE_LOGE("Failed to get device name");
     return false;
@@ -354,250 +536,1038 @@ std::string readDeviceNameFromNVS(const NimBLEAddress& addr) {
   return name.c_str();
 }
 
-void taskConnect(void* arg) {
-  NimBLEAdvertisedDevice* advertisedDevice;
+// Name and appearance are read from the device only until both are stored.
+bool isDeviceInfoInNVS(const NimBLEAddress& addr) {
+  auto nameKey = stripColon(addr.toString());
+  auto appearanceKey = stripColon(addr.toString() + "AP");
+  return NVS.getString(nameKey.c_str()).length() > 0 && NVS.getInt(appearanceKey.c_str(), 0) != 0;
+}
+
+void saveDeviceInfoToNVS(NimBLEClient* client) {
+  if (isDeviceInfoInNVS(client->getPeerAddress())) {
+    return;
+  }
+  auto service = client->getService(NimBLEUUID(SERVICE_UUID_GENERIC_ACCESS));
+  if (service == nullptr) {
+    PS2BLE_LOGE("Generic Access service not found");
+    return;
+  }
+  auto ok = saveDeviceNameToNVS(client, service);
+  if (!ok) {
+    PS2BLE_LOGE("Failed to save device name to NVS");
+  }
+  ok = saveAppearanceToNVS(client, service);
+  if (!ok) {
+    PS2BLE_LOGE("Failed to save appearance to NVS");
+  }
+}
+
+// Time spent in each phase of setting up a connection.
+class ConnectionSetupTimer {
+ private:
+  std::int64_t startMicros;
+  std::int64_t lastMicros;
+  std::string phases;
+
+ public:
+  ConnectionSetupTimer() : startMicros(esp_timer_get_time()), lastMicros(startMicros) {}
+  // Ends the current phase.
+  void mark(const char* phase) {
+    auto now = esp_timer_get_time();
+    phases += fmt::format("{}: {} us, ", phase, now - lastMicros);
+    lastMicros = now;
+  }
+  std::string toString() const { return fmt::format("{}total: {} us", phases, lastMicros - startMicros); }
+};
+
+// Number of tasks which set up connected devices, so a slow device does not hold up the others.
+#ifndef PS2BLE_CONNECTION_SETUP_TASKS
+#define PS2BLE_CONNECTION_SETUP_TASKS 3
+#endif
+
+// Each link goes from Connecting (taskConnect, one at a time as the controller initiates one connection at a time) to
+// SettingUp (one of the setup tasks) to Ready. Links which are not in the map are disconnected.
+enum class LinkState : uint8_t {
+  Connecting,
+  SettingUp,
+  Ready,
+};
+
+class ConnectionSetup {
+ public:
+  NimBLEClient* client;
+  ConnectionSetupTimer timer;
+};
+
+QueueHandle_t xQueueConnectionSetup;
+std::map<NimBLEAddress, LinkState> LinkStates;
+std::int64_t AllLinksReadySinceMicros = 0;  // Start of the current wait for all bonded devices, -1 while all are ready
+std::mutex LinkStatesMutex;
+
+bool isLinkInProgress(const NimBLEAddress& addr) {
+  std::lock_guard<std::mutex> lock(LinkStatesMutex);
+  return LinkStates.find(addr) != LinkStates.end();
+}
+
+// Bonded devices whose link is up, whether or not its setup has finished.
+int getConnectedBondedCount() {
+  std::lock_guard<std::mutex> lock(LinkStatesMutex);
+  auto count = 0;
+  for (const auto& link : LinkStates) {
+    if (link.second != LinkState::Connecting && isBondedAddress(link.first)) {
+      count++;
+    }
+  }
+  return count;
+}
+
+void setLinkState(const NimBLEAddress& addr, LinkState state) {
+  std::lock_guard<std::mutex> lock(LinkStatesMutex);
+  LinkStates[addr] = state;
+  // An attempt which has not connected yet does not change what the scan waits for.
+  if (state != LinkState::Connecting) {
+    xEventGroupSetBits(xEventGroupScan, SCAN_EVENT_LINKS_CHANGED);
+  }
+  if (state != LinkState::Ready || AllLinksReadySinceMicros < 0) {
+    return;
+  }
+  auto bondCount = getBondedAddresses().size();
+  auto readyCount = std::count_if(LinkStates.begin(), LinkStates.end(),
+                                  [](const std::pair<const NimBLEAddress, LinkState>& link) { return link.second == LinkState::Ready; });
+  if (bondCount > 0 && readyCount >= bondCount) {
+    PS2BLE_LOGI(fmt::format("All {} bonded devices ready in {} ms", bondCount, (esp_timer_get_time() - AllLinksReadySinceMicros) / 1000));
+    AllLinksReadySinceMicros = -1;
+  }
+}
+
+void removeLinkState(const NimBLEAddress& addr) {
+  std::lock_guard<std::mutex> lock(LinkStatesMutex);
+  auto link = LinkStates.find(addr);
+  if (link == LinkStates.end()) {
+    return;
+  }
+  auto wasConnected = link->second != LinkState::Connecting;
+  LinkStates.erase(link);
+  // A failed attempt, e.g. AutoConnect waiting for a sleeping device, wakes nobody.
+  if (!wasConnected) {
+    return;
+  }
+  xEventGroupSetBits(xEventGroupScan, SCAN_EVENT_LINKS_CHANGED);
+  isAutoConnectRequested.store(true);
+  xTaskNotifyGive(taskConnectHandle);
+  if (AllLinksReadySinceMicros < 0) {
+    AllLinksReadySinceMicros = esp_timer_get_time();
+  }
+}
+
+// A link from the start of its connection until it is lost, with its class and the last parameters requested for it.
+// The class is read from NVS by the connecting and setup tasks, so the host callbacks neither read NVS nor walk the
+// client list, which taskConnect may change meanwhile.
+class ConnParamsLink {
+ public:
+  NimBLEClient* client;  // Clients are reused but never deleted
+  LinkClass linkClass;
+  ConnParams applied;
+};
+
+std::map<NimBLEAddress, ConnParamsLink> ConnParamsLinks;
+std::mutex ConnParamsMutex;
+
+LinkClass getLinkClass(const NimBLEAddress& addr) { return getLinkClass(readAppearanceFromNVS(addr)); }
+
+std::int32_t getIntervalScalePercent() {
+  std::vector<LinkClass> linkClasses;
+  for (const auto& link : ConnParamsLinks) {
+    linkClasses.push_back(link.second.linkClass);
+  }
+  return ConnParamsPolicy::getIntervalScalePercent(linkClasses);
+}
+
+// Adds a device which is about to connect and returns its parameters within the radio budget of all links, itself included.
+ConnParams addConnParamsLink(NimBLEClient* client, const NimBLEAddress& addr, LinkClass linkClass) {
+  std::lock_guard<std::mutex> lock(ConnParamsMutex);
+  auto& link = ConnParamsLinks[addr];
+  link.client = client;
+  link.linkClass = linkClass;
+  link.applied = ConnParamsPolicy::getParams(linkClass, getIntervalScalePercent());
+  return link.applied;
+}
+
+// A device seen for the first time may turn out to be of another class once its appearance was read.
+void setConnParamsLinkClass(const NimBLEAddress& addr, LinkClass linkClass) {
+  std::lock_guard<std::mutex> lock(ConnParamsMutex);
+  auto link = ConnParamsLinks.find(addr);
+  if (link != ConnParamsLinks.end()) {
+    link->second.linkClass = linkClass;
+  }
+}
+
+// Parameters for a connected device within the radio budget of all links.
+ConnParams getConnParams(const NimBLEAddress& addr) {
+  std::lock_guard<std::mutex> lock(ConnParamsMutex);
+  auto link = ConnParamsLinks.find(addr);
+  auto linkClass = link != ConnParamsLinks.end() ? link->second.linkClass : LinkClass::Standard;
+  return ConnParamsPolicy::getParams(linkClass, getIntervalScalePercent());
+}
+
+void eraseConnParams(const NimBLEAddress& addr) {
+  std::lock_guard<std::mutex> lock(ConnParamsMutex);
+  ConnParamsLinks.erase(addr);
+}
+
+// A link which was set up or lost changes the scale of every link. Only links whose parameters change are updated.
+void rebalanceConnParams() {
+  std::vector<ConnParamsLink> updates;
+  std::int32_t scalePercent;
+  {
+    std::lock_guard<std::mutex> lock(ConnParamsMutex);
+    scalePercent = getIntervalScalePercent();
+    for (auto& link : ConnParamsLinks) {
+      auto params = ConnParamsPolicy::getParams(link.second.linkClass, scalePercent);
+      // A link still connecting gets its parameters when the connection is initiated.
+      if (link.second.applied == params || !link.second.client->isConnected()) {
+        continue;
+      }
+      link.second.applied = params;
+      updates.push_back(link.second);
+    }
+  }
+  for (const auto& link : updates) {
+    const auto& params = link.applied;
+    link.client->updateConnParams(params.minInterval, params.maxInterval, params.latency, params.supervisionTimeout);
+    PS2BLE_LOGI(fmt::format("Updating connection parameters of {} ({}, scale {}%): interval: {}, latency: {}, supervision_timeout: {}",
+                            link.client->getPeerAddress().toString(), getLinkClassName(link.linkClass), scalePercent,
+                            params.minInterval, params.latency, params.supervisionTimeout));
+  }
+}
+
+// Whether the user pinned the device, saved as "<address>PN". Pinned devices come first for a connection slot.
+bool readPinnedFromNVS(const NimBLEAddress& addr) {
+  auto key = stripColon(addr.toString() + "PN");
+  return NVS.getInt(key.c_str(), 0) != 0;
+}
+
+bool savePinnedToNVS(const NimBLEAddress& addr, bool isPinned) {
+  auto key = stripColon(addr.toString() + "PN");
+  auto ok = NVS.setInt(key.c_str(), static_cast<std::uint8_t>(isPinned));
+  if (!ok) {
+    PS2BLE_LOGE("Failed to save pinned state to NVS");
+    return false;
+  }
+  PS2BLE_LOGI(fmt::format("Saved pinned state to NVS: {} = {}", addr.toString(), isPinned));
+  return true;
+}
+
+std::map<NimBLEAddress, std::int64_t> LinkActivity;  // Time of the last input report of each connected device
+std::mutex LinkActivityMutex;
+
+void touchLinkActivity(const NimBLEAddress& addr, std::int64_t nowMicros) {
+  std::lock_guard<std::mutex> lock(LinkActivityMutex);
+  LinkActivity[addr] = nowMicros;
+}
+
+void eraseLinkActivity(const NimBLEAddress& addr) {
+  std::lock_guard<std::mutex> lock(LinkActivityMutex);
+  LinkActivity.erase(addr);
+}
+
+std::int64_t getLinkActivity(const NimBLEAddress& addr) {
+  std::lock_guard<std::mutex> lock(LinkActivityMutex);
+  auto activity = LinkActivity.find(addr);
+  return activity != LinkActivity.end() ? activity->second : 0;
+}
+
+constexpr TickType_t EVICT_TIMEOUT_TICKS = pdMS_TO_TICKS(1000);  // Longest wait for an evicted link to disconnect
+
+// Makes room for the device among the controller's connections. Only a device known to be in range, i.e. found by the
+// scan, may take the slot of another link; an AutoConnect attempt waits for a free one. Returns Evict after starting to
+// disconnect the link to evictedAddr, whose slot is free once waitForEviction has seen it go.
+SlotDecision acquireConnectionSlot(const NimBLEAddress& addr, bool isBonded, bool mayEvict, NimBLEAddress& evictedAddr) {
+  std::vector<LinkSlot> links;
+  std::vector<NimBLEClient*> clients;
+  for (auto client : *NimBLEDevice::getClientList()) {
+    if (!client->isConnected()) {
+      continue;
+    }
+    auto peerAddr = client->getPeerAddress();
+    LinkSlot link;
+    link.address = getAddressKey(peerAddr);
+    link.priority = ConnectionSlotPolicy::getPriority(readPinnedFromNVS(peerAddr), isBondedAddress(peerAddr));
+    link.lastActivityMicros = getLinkActivity(peerAddr);
+    links.push_back(link);
+    clients.push_back(client);
+  }
+  auto priority = ConnectionSlotPolicy::getPriority(readPinnedFromNVS(addr), isBonded);
+  std::size_t evictIndex = 0;
+  auto decision = ConnectionSlotPolicy::decide(links, CONFIG_BT_NIMBLE_MAX_CONNECTIONS, priority, esp_timer_get_time(), evictIndex);
+  if (decision == SlotDecision::Admit) {
+    return SlotDecision::Admit;
+  }
+  if (decision == SlotDecision::Reject || !mayEvict) {
+    PS2BLE_LOGD(fmt::format("No connection slot for {}", addr.toString()));
+    return SlotDecision::Reject;
+  }
+  auto evictedClient = clients[evictIndex];
+  evictedAddr = evictedClient->getPeerAddress();
+  PS2BLE_LOGI(fmt::format("Disconnecting {} to make room for {}", evictedAddr.toString(), addr.toString()));
+  xSemaphoreTake(xSemaphoreLinkDisconnected, 0);
+  evictedClient->disconnect();
+  return SlotDecision::Evict;
+}
+
+// Waits on taskConnect, outside taskBleCommand, until the evicted link is gone. The slot is free once onDisconnect has
+// removed the link. Another link may drop meanwhile, so the wait goes on until the evicted one is gone.
+bool waitForEviction(const NimBLEAddress& evictedAddr) {
+  const auto deadline = xTaskGetTickCount() + EVICT_TIMEOUT_TICKS;
+  while (isLinkInProgress(evictedAddr)) {
+    auto now = xTaskGetTickCount();
+    if (static_cast<std::int32_t>(deadline - now) <= 0 || xSemaphoreTake(xSemaphoreLinkDisconnected, deadline - now) != pdTRUE) {
+      break;
+    }
+  }
+  return !isLinkInProgress(evictedAddr);
+}
+
+// Returns the client for a connection to the device. The device's own client is kept across connections as it holds
+// the attributes discovered before. Otherwise a disconnected client is reused, preferably one of a device which is not
+// bonded, and a new one is only created while there are fewer clients than connection slots. Returns nullptr if every
+// client is in use.
+NimBLEClient* getClientForDevice(const NimBLEAddress& addr) {
+  auto client = NimBLEDevice::getClientByPeerAddress(addr);
+  if (client != nullptr) {
+    return client;
+  }
+  for (auto candidate : *NimBLEDevice::getClientList()) {
+    if (candidate->isConnected() || isLinkInProgress(candidate->getPeerAddress())) {
+      continue;
+    }
+    if (client == nullptr || (isBondedAddress(client->getPeerAddress()) && !isBondedAddress(candidate->getPeerAddress()))) {
+      client = candidate;
+    }
+  }
+  if (client == nullptr && NimBLEDevice::getClientListSize() < CONFIG_BT_NIMBLE_MAX_CONNECTIONS) {
+    client = NimBLEDevice::createClient();
+  }
+  return client;
+}
+
+void taskSetUpConnection(void* arg) {
+  ConnectionSetup* setup;
   while (true) {
-    if (xQueueReceive(xQueueDeviceToConnect, &advertisedDevice, portMAX_DELAY) == pdTRUE) {
-      // Save current scan mode.
-      ScanMode currentScanMode = ScanMode::BoundedDeviceOnly;
-      auto ret = xQueuePeek(xQueueScanMode, &currentScanMode, 0);
-      if (ret != pdTRUE) {
-        PS2BLE_LOGE("xQueuePeek failed for xQueueScanMode");
+    if (xQueueReceive(xQueueConnectionSetup, &setup, portMAX_DELAY) == pdTRUE) {
+      auto addr = setup->client->getPeerAddress();
+      setUpConnection(setup->client, setup->timer);
+      if (setup->client->isConnected()) {
+        setLinkState(addr, LinkState::Ready);
+        PS2BLE_LOGI(fmt::format("Connection set up for {}: {}", addr.toString(), setup->timer.toString()));
+        // Pointer input lags visibly on a slow link, whatever the device's appearance says.
+        setConnParamsLinkClass(addr, hasPointerReports(addr) ? LinkClass::LowLatency : getLinkClass(addr));
+        rebalanceConnParams();
       }
+      delete setup;
+    }
+  }
+}
 
-      // Prevent taskScan to resatart scan.
-      auto scanMode = ScanMode::Disabled;
-      ret = xQueueOverwrite(xQueueScanMode, &scanMode);
-      if (ret != pdTRUE) {
-        PS2BLE_LOGE("xQueueOverwrite failed for xQueueScanMode");
+// Next disconnected bonded device of the current AutoConnect round. NimBLEClient in NimBLE-Arduino 1.4 only initiates
+// connections to one address and keeps its GAP event handler private, so a white-list connection for all devices at once
+// is not possible without bypassing the client. Instead the controller waits for each device with a short timeout, once
+// per round; a device asleep during the round is found by the scan afterwards, so a waking mouse never waits for the
+// other devices' timeouts.
+bool takeAutoConnectCandidate(std::size_t& nextBondIndex, ConnectCandidate& candidate) {
+  auto bondedAddresses = getBondedAddresses();
+  for (; nextBondIndex < bondedAddresses.size(); nextBondIndex++) {
+    const auto& addr = bondedAddresses[nextBondIndex];
+    if (isLinkInProgress(addr)) {
+      continue;
+    }
+    nextBondIndex++;
+    candidate.address = getAddressKey(addr);
+    candidate.addressType = addr.getType();
+    candidate.rssi = 0;
+    candidate.lastSeenMicros = esp_timer_get_time();
+    candidate.isBonded = true;
+    return true;
+  }
+  return false;
+}
+
+void taskConnect(void* arg) {
+  ConnectCandidate candidate;
+  std::size_t autoConnectIndex = 0;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (isAutoConnectRequested.exchange(false) && getScanMode() == ScanMode::AutoConnect) {
+      autoConnectIndex = 0;
+      setAutoConnectRoundActive(true);
+    }
+    // Devices found by the scan go first, then the rest of the AutoConnect round.
+    while (true) {
+      auto isAutoConnectAttempt = false;
+      if (!ConnectCandidates.takeBest(esp_timer_get_time(), candidate)) {
+        auto isAutoConnectRound = isAutoConnectRoundActive.load() && getScanMode() == ScanMode::AutoConnect;
+        if (!isAutoConnectRound || !takeAutoConnectCandidate(autoConnectIndex, candidate)) {
+          if (isAutoConnectRoundActive.load()) {
+            setAutoConnectRoundActive(false);  // Leave the remaining devices to the scan
+          }
+          break;
+        }
+        isAutoConnectAttempt = true;
+      }
+      auto candidateAddr = getCandidateAddress(candidate);
+      // Devices which are being connected or set up keep advertising for a while; they are ignored.
+      if (isLinkInProgress(candidateAddr)) {
+        continue;
       }
 
-      // Try to use the existing client to reduce the connection time.
-      NimBLEClient* client = NimBLEDevice::getClientByPeerAddress(advertisedDevice->getAddress());
-      // If the existing client is not available, create a new client.
+      // The client list and the connection slots are managed on taskBleCommand, like the bonds. After an eviction the
+      // slot is asked for again once the link is gone, without evicting another one.
+      auto decision = SlotDecision::Reject;
+      NimBLEClient* client = nullptr;
+      for (auto mayEvict = !isAutoConnectAttempt;; mayEvict = false) {
+        NimBLEAddress evictedAddr;
+        runBleCommand(
+            [&]() {
+              decision = acquireConnectionSlot(candidateAddr, candidate.isBonded, mayEvict, evictedAddr);
+              if (decision == SlotDecision::Admit) {
+                client = getClientForDevice(candidateAddr);
+              }
+            },
+            portMAX_DELAY);
+        if (decision != SlotDecision::Evict || !waitForEviction(evictedAddr)) {
+          break;
+        }
+      }
+      if (decision != SlotDecision::Admit) {
+        if (isAutoConnectAttempt) {
+          setAutoConnectRoundActive(false);  // No free slot, the scan takes over
+          break;
+        }
+        continue;
+      }
       if (client == nullptr) {
-        client = NimBLEDevice::createClient();
+        PS2BLE_LOGE(fmt::format("No client available for {}", candidateAddr.toString()));
+        continue;
       }
+      // Using the device's own client reduces the connection time. The attributes it discovered before are kept, with
+      // their handles and subscriptions, unless the GATT cache was dropped because of Service Changed.
+      auto isReusingAttributes = client->getPeerAddress() == candidateAddr && isGattCacheValid(candidateAddr);
+
+      // Prevent taskScan from restarting the scan while the controller initiates the connection.
+      setScanPaused(true);
 
       client->setClientCallbacks(&clientCB, false);
-      const auto minInterval = 12;          // 12 * 1.25ms = 15ms
-      const auto maxInterval = 12;          // 12 * 1.25ms = 15ms
-      const auto slaveLatency = 0;          // The number of packets allowed to skip. Helps peripheral save power.
-      const auto supervisionTimeout = 510;  // 51 * 10ms = 510ms
-      client->setConnectionParams(minInterval, maxInterval, slaveLatency, supervisionTimeout);
-      client->setConnectTimeout(5);  // The timeout to wait for connection attempt to complete.
-      auto isConnected = client->connect(advertisedDevice);
+      // Bonded devices are known by their appearance saved in NVS, new devices start with the Standard class.
+      auto connParams = addConnParamsLink(client, candidateAddr, getLinkClass(candidateAddr));
+      client->setConnectionParams(connParams.minInterval, connParams.maxInterval, connParams.latency, connParams.supervisionTimeout);
+      // The timeout to wait for connection attempt to complete.
+      client->setConnectTimeout(isAutoConnectAttempt ? PS2BLE_AUTO_CONNECT_TIMEOUT : 5);
+      auto setup = new ConnectionSetup{client};
+      setLinkState(candidateAddr, LinkState::Connecting);
+      auto isConnected = client->connect(candidateAddr, !isReusingAttributes);
+      setup->timer.mark("connect");
       if (isConnected) {
         auto addr = client->getPeerAddress();
-        ret = xQueueOverwrite(xQueueLastConnectedDevice, &addr);
+        auto ret = xQueueOverwrite(xQueueLastConnectedDevice, &addr);
         if (ret != pdTRUE) {
           PS2BLE_LOGE("xQueueOverwrite failed for xQueueLastConnectedDevice");
         }
         PS2BLE_LOGI(fmt::format("Connected to: {}", client->getPeerAddress().toString()));
-        auto ok = saveDeviceNameToNVS(client);
-        if (!ok) {
-          PS2BLE_LOGE("Failed to save device name to NVS");
-        }
-        ok = saveAppearanceToNVS(client);
-        if (!ok) {
-          PS2BLE_LOGE("Failed to save appearance to NVS");
-        }
-        subscribeToHIDService(client);
+        touchLinkActivity(addr, esp_timer_get_time());
+        // Discovery and subscriptions run on a setup task, so the next device can be connected meanwhile.
+        setLinkState(addr, LinkState::SettingUp);
+        xQueueSend(xQueueConnectionSetup, &setup, portMAX_DELAY);
       } else {
-        PS2BLE_LOGI(fmt::format("Failed to connect to: {}", client->getPeerAddress().toString()));
-        BLEDevice::deleteClient(client);
+        // AutoConnect attempts time out whenever the device is asleep, so they are not worth logging.
+        if (isAutoConnectAttempt) {
+          PS2BLE_LOGV(fmt::format("Device not in range: {}", candidateAddr.toString()));
+        } else {
+          PS2BLE_LOGI(fmt::format("Failed to connect to: {}", client->getPeerAddress().toString()));
+        }
+        removeLinkState(candidateAddr);
+        eraseConnParams(candidateAddr);
+        // The client is kept for the next attempt, with the attributes of an earlier connection if it had any.
+        delete setup;
       }
 
-      // Restore scan mode.
-      ret = xQueueOverwrite(xQueueScanMode, &currentScanMode);
-      if (ret != pdTRUE) {
-        PS2BLE_LOGE("xQueueOverwrite failed for xQueueScanMode");
-      }
+      // Resume scanning as soon as the controller is no longer initiating.
+      setScanPaused(false);
     }
   }
   vTaskDelete(NULL);
 }
 
+// Operations which change the client list, the connection slots or the bond store run one at a time on taskBleCommand:
+// choosing and creating the client of a connection (taskConnect), reading and deleting bonds (web server and host
+// callbacks). Connecting, discovery and input reports stay on their own tasks, which only read snapshots such as
+// getBondedAddresses().
+class BleCommand {
+ public:
+  enum class State {
+    Queued,
+    Running,
+    Cancelled,  // The caller gave up waiting before the command started
+  };
+  std::function<void()> run;
+  SemaphoreHandle_t done = nullptr;  // nullptr for a posted command, which nobody waits for
+  std::atomic<State> state{State::Queued};
+};
+
+// Longest time a web request waits for the command task before it answers that BLE is busy, so AsyncTCP is not stalled
+// behind a connection attempt.
+constexpr TickType_t BLE_COMMAND_WEB_TIMEOUT_TICKS = pdMS_TO_TICKS(2000);
+
+QueueHandle_t xQueueBleCommand;
+
+// Commands are freed by their caller once done, except posted and cancelled ones, which are freed here.
+void taskBleCommand(void* arg) {
+  BleCommand* command;
+  while (true) {
+    if (xQueueReceive(xQueueBleCommand, &command, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    if (command->done == nullptr) {
+      command->run();
+      delete command;
+      continue;
+    }
+    auto expected = BleCommand::State::Queued;
+    if (!command->state.compare_exchange_strong(expected, BleCommand::State::Running)) {
+      vSemaphoreDelete(command->done);
+      delete command;
+      continue;
+    }
+    command->run();
+    xSemaphoreGive(command->done);
+  }
+}
+
+// Runs the operation on taskBleCommand and waits for it to finish. Returns false without running it if it did not start
+// within the timeout. Once started, it is waited for, as it may use the caller's variables.
+bool runBleCommand(const std::function<void()>& run, TickType_t timeout) {
+  auto command = new BleCommand();
+  command->run = run;
+  command->done = xSemaphoreCreateBinary();
+  if (command->done == nullptr) {
+    PS2BLE_LOGE("xSemaphoreCreateBinary failed for BLE command");
+    delete command;
+    return false;
+  }
+  const auto startTicks = xTaskGetTickCount();
+  if (xQueueSend(xQueueBleCommand, &command, timeout) != pdTRUE) {
+    PS2BLE_LOGW("BLE command queue full");
+    vSemaphoreDelete(command->done);
+    delete command;
+    return false;
+  }
+  auto elapsedTicks = xTaskGetTickCount() - startTicks;
+  auto remainingTicks = timeout == portMAX_DELAY ? portMAX_DELAY : (elapsedTicks < timeout ? timeout - elapsedTicks : 0);
+  if (xSemaphoreTake(command->done, remainingTicks) != pdTRUE) {
+    auto expected = BleCommand::State::Queued;
+    if (command->state.compare_exchange_strong(expected, BleCommand::State::Cancelled)) {
+      PS2BLE_LOGW("BLE command timed out");
+      return false;  // taskBleCommand frees it
+    }
+    xSemaphoreTake(command->done, portMAX_DELAY);
+  }
+  vSemaphoreDelete(command->done);
+  delete command;
+  return true;
+}
+
+// Queues the operation without waiting for it, for callers which must not block such as the host callbacks.
+bool postBleCommand(const std::function<void()>& run) {
+  auto command = new BleCommand();
+  command->run = run;
+  if (xQueueSend(xQueueBleCommand, &command, 0) != pdTRUE) {
+    delete command;
+    return false;
+  }
+  return true;
+}
+
+// Guards the per-report state of the connected devices: LastKeyboardReport, MouseStatusMap and DigitizerTrackerMap.
+// The setup tasks create the entries before subscribing, and the notify callbacks on the NimBLE host task only look them up,
+// so a report never inserts into a map which another task changes. Entries are kept after disconnecting.
+std::mutex ReportStatusMutex;
 std::map<std::pair<NimBLEAddress, reportID_t>, KeyboardReport> LastKeyboardReport;
 
+// Keeps the last report of a reconnecting keyboard, so keys held when the link dropped are released by its next report.
+void initKeyboardStatus(const NimBLEAddress& addr, reportID_t reportID) {
+  std::lock_guard<std::mutex> lock(ReportStatusMutex);
+  LastKeyboardReport.emplace(std::make_pair(addr, reportID), KeyboardReport());
+}
+
+// Looks up the report ID of a report characteristic and the report map of its device.
+// False if the GATT cache of the device was dropped, e.g. after Service Changed, until it is set up again.
+bool findCachedReport(const NimBLEAddress& addr, std::uint16_t handle, reportID_t& reportID, std::shared_ptr<ReportMap>* reportMap) {
+  std::lock_guard<std::mutex> lock(GattCacheMutex);
+  auto referencesIt = ReportReferenceCache.find(addr);
+  if (referencesIt == ReportReferenceCache.end()) {
+    return false;
+  }
+  auto referenceIt = referencesIt->second.find(handle);
+  if (referenceIt == referencesIt->second.end()) {
+    return false;
+  }
+  reportID = referenceIt->second.reportID;
+  if (reportMap != nullptr) {
+    auto reportMapIt = ReportMapCache.find(addr);
+    if (reportMapIt == ReportMapCache.end()) {
+      return false;
+    }
+    *reportMap = reportMapIt->second;
+  }
+  return true;
+}
+
 void notifyCallbackKeyboardHIDReport(NimBLERemoteCharacteristic* pRemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify) {
   auto addr = pRemoteCharacteristic->getRemoteService()->getClient()->getPeerAddress();
-  auto handle = pRemoteCharacteristic->getHandle();
-  auto reportID = HandleReportIDMapCache[addr][handle];
-  auto reportMap = ReportMapCache[addr];
+  touchLinkActivity(addr, esp_timer_get_time());
+  reportID_t reportID;
+  std::shared_ptr<ReportMap> reportMap;
+  if (!findCachedReport(addr, pRemoteCharacteristic->getHandle(), reportID, &reportMap)) {
+    return;
+  }
   auto reportItemList = reportMap->getInputReportItemList(reportID);
   auto report = decodeKeyboardInputReport(pData, *reportItemList);
-  auto pressedKeys = report.getPressedKeys();
   auto usagePage = static_cast<UsagePage>(report.getUsagePage());
-  // if last report is not empty, compare with current report
-  if (LastKeyboardReport.find({addr, reportID}) != LastKeyboardReport.end()) {
-    auto lastReport = LastKeyboardReport[{addr, reportID}];
-    auto currentReport = report;
-    auto lastPressedKeys = lastReport.getPressedKeys();
-    auto currentPressedKeys = pressedKeys;
-
-    // check for key up
-    for (auto& lastPressedKey : lastPressedKeys) {
-      auto isKeyUp = std::find(currentPressedKeys.begin(), currentPressedKeys.end(), lastPressedKey) == currentPressedKeys.end();
-      if (isKeyUp) {
-        auto scanCode = getScanCode(lastPressedKey, ScanCodeType::Break, usagePage, ScanCodeSet::Set2);
-        if (scanCode == nullptr) {
-          PS2BLE_LOGE(fmt::format("scanCode not found for 0x{:04X}", lastPressedKey));
-          continue;
-        }
-        auto scanCodeData = *scanCode->getCode();
-        keyboard.send_scancode(scanCodeData);
-      }
-    }
-    // check for key down
-    for (auto& currentPressedKey : currentPressedKeys) {
-      auto isKeyDown = std::find(lastPressedKeys.begin(), lastPressedKeys.end(), currentPressedKey) == lastPressedKeys.end();
-      if (isKeyDown) {
-        auto scanCode = getScanCode(currentPressedKey, ScanCodeType::Make, usagePage, ScanCodeSet::Set2);
-        if (scanCode == nullptr) {
-          PS2BLE_LOGE(fmt::format("scanCode not found for 0x{:04X}", currentPressedKey));
-          continue;
-        }
-        auto scanCodeData = *scanCode->getCode();
-        keyboard.send_scancode(scanCodeData);
+  std::lock_guard<std::mutex> lock(ReportStatusMutex);
+  auto lastReportIt = LastKeyboardReport.find({addr, reportID});
+  if (lastReportIt == LastKeyboardReport.end()) {
+    return;
+  }
+  // compare with the last report, which is empty for a newly connected keyboard
+  auto lastPressedKeys = lastReportIt->second.getPressedKeys();
+  auto currentPressedKeys = report.getPressedKeys();
+
+  // check for key up
+  for (auto& lastPressedKey : lastPressedKeys) {
+    auto isKeyUp = std::find(currentPressedKeys.begin(), currentPressedKeys.end(), lastPressedKey) == currentPressedKeys.end();
+    if (isKeyUp) {
+      auto scanCode = getScanCode(lastPressedKey, ScanCodeType::Break, usagePage, ScanCodeSet::Set2);
+      if (scanCode == nullptr) {
+        PS2BLE_LOGE(fmt::format("scanCode not found for 0x{:04X}", lastPressedKey));
+        continue;
       }
+      auto scanCodeData = *scanCode->getCode();
+      keyboardPort.sendScanCode(scanCodeData);
     }
-  } else {
-    // if last report is empty, send all key down
-    for (auto& pressedKey : pressedKeys) {
-      auto scanCode = getScanCode(pressedKey, ScanCodeType::Make, usagePage, ScanCodeSet::Set2);
+  }
+  // check for key down
+  for (auto& currentPressedKey : currentPressedKeys) {
+    auto isKeyDown = std::find(lastPressedKeys.begin(), lastPressedKeys.end(), currentPressedKey) == lastPressedKeys.end();
+    if (isKeyDown) {
+      auto scanCode = getScanCode(currentPressedKey, ScanCodeType::Make, usagePage, ScanCodeSet::Set2);
       if (scanCode == nullptr) {
-        PS2BLE_LOGE(fmt::format("scanCode not found for 0x{:04X}", pressedKey));
+        PS2BLE_LOGE(fmt::format("scanCode not found for 0x{:04X}", currentPressedKey));
         continue;
       }
       auto scanCodeData = *scanCode->getCode();
-      keyboard.send_scancode(scanCodeData);
+      keyboardPort.sendScanCode(scanCodeData);
     }
   }
   // update last report
-  LastKeyboardReport[{addr, reportID}] = report;
+  lastReportIt->second = report;
   PS2BLE_LOGI(report.toString());
 }
 
+// Per-device mouse settings are stored in NVS as "<address>MS" (scale in percent) and "<address>MA" (acceleration on/off).
+MotionTransformConfig readMotionTransformConfigFromNVS(const NimBLEAddress& addr) {
+  MotionTransformConfig config;
+  auto scaleKey = stripColon(addr.toString() + "MS");
+  auto scalePercent = NVS.getInt(scaleKey.c_str());
+  if (scalePercent > 0) {
+    config.scale = percentToFixed16(scalePercent);
+  }
+  auto accelerationKey = stripColon(addr.toString() + "MA");
+  auto acceleration = NVS.getInt(accelerationKey.c_str(), -1);
+  if (acceleration != -1) {
+    config.isAccelerationEnabled = acceleration != 0;
+  }
+  return config;
+}
+
+bool saveMouseSettingsToNVS(const NimBLEAddress& addr, std::uint16_t scalePercent, bool isAccelerationEnabled) {
+  auto scaleKey = stripColon(addr.toString() + "MS");
+  auto ok = NVS.setInt(scaleKey.c_str(), scalePercent);
+  if (!ok) {
+    PS2BLE_LOGE("Failed to save mouse scale to NVS");
+    return false;
+  }
+  auto accelerationKey = stripColon(addr.toString() + "MA");
+  ok = NVS.setInt(accelerationKey.c_str(), static_cast<std::uint8_t>(isAccelerationEnabled));
+  if (!ok) {
+    PS2BLE_LOGE("Failed to save mouse acceleration to NVS");
+    return false;
+  }
+  PS2BLE_LOGI(fmt::format("Saved mouse settings to NVS: {} = {}%, acceleration: {}", addr.toString(), scalePercent, isAccelerationEnabled));
+  return true;
+}
+
+// Per-device state of a BLE mouse. Set up while subscribing and then only touched from the NimBLE host task, always under
+// ReportStatusMutex.
 class MouseStatus {
  public:
-  boost::circular_buffer<MouseReport> hidReportBuf = boost::circular_buffer<MouseReport>(10);
-  unsigned long lastPs2ReportTimeMicros = 0;
+  MouseReportLayout layout;
+  MotionTransform transform;
+  LinkPhaseEstimator linkPhase;
+  std::atomic<std::int32_t> wheelResolution{1};  // Wheel units per detent, i.e. the Resolution Multiplier
+  std::int32_t wheelVertical = 0;                // Fraction of a detent not sent yet
+  std::int32_t wheelHorizontal = 0;              // Fraction of a detent not sent yet
+  std::uint8_t buttons = 0;
 };
 std::map<std::pair<NimBLEAddress, reportID_t>, MouseStatus> MouseStatusMap;
+// Touch pads and pens, which are merged into the PS/2 mouse through their MouseStatus
+std::map<std::pair<NimBLEAddress, reportID_t>, DigitizerTracker> DigitizerTrackerMap;
+
+// Removes whole detents from the accumulated wheel units and returns them. The fraction stays for the next report.
+std::int32_t takeWholeDetents(std::int32_t& units, std::int32_t resolution) {
+  auto detents = units / resolution;
+  units -= detents * resolution;
+  return detents;
+}
+
+// Initializes mouse status before subscribing, so settings changed while disconnected apply on reconnect.
+void initMouseStatus(const NimBLEAddress& addr, const ReportItemList* reportItemList) {
+  auto config = readMotionTransformConfigFromNVS(addr);
+  std::lock_guard<std::mutex> lock(ReportStatusMutex);
+  auto& mouseStatus = MouseStatusMap[{addr, reportItemList->getReportID()}];
+  mouseStatus.layout = getMouseReportLayout(*reportItemList);
+  mouseStatus.transform.setConfig(config);
+  mouseStatus.linkPhase = LinkPhaseEstimator();  // Connection-event timing changes with every connection
+  // The mouse starts with Resolution Multiplier 1 after connecting, enableHighResolutionScroll raises it.
+  mouseStatus.wheelResolution = 1;
+}
+
+void initDigitizerStatus(const NimBLEAddress& addr, const ReportItemList* reportItemList) {
+  const std::pair<NimBLEAddress, reportID_t> key = {addr, reportItemList->getReportID()};
+  auto config = readMotionTransformConfigFromNVS(addr);
+  std::lock_guard<std::mutex> lock(ReportStatusMutex);
+  auto& mouseStatus = MouseStatusMap[key];
+  mouseStatus.transform.setConfig(config);
+  mouseStatus.linkPhase = LinkPhaseEstimator();
+  // Two-finger scrolling is converted to pointer counts, so a detent is a fixed scroll distance.
+  mouseStatus.wheelResolution = DigitizerTracker::SCROLL_COUNTS_PER_DETENT;
+  DigitizerTrackerMap[key].setLayout(getDigitizerReportLayout(*reportItemList));
+}
+
+// Returns true if the device has a mouse or digitizer report which is forwarded as PS/2 mouse input.
+bool hasPointerReports(const NimBLEAddress& addr) {
+  std::lock_guard<std::mutex> lock(ReportStatusMutex);
+  auto it = MouseStatusMap.lower_bound({addr, 0});
+  return it != MouseStatusMap.end() && it->first.first == addr;
+}
+
+// Releases the buttons held by a disconnected mouse, so they do not stay pressed on the merged PS/2 mouse.
+void releaseMouseButtons(const NimBLEAddress& addr) {
+  std::lock_guard<std::mutex> lock(ReportStatusMutex);
+  for (auto& [key, mouseStatus] : MouseStatusMap) {
+    if (key.first != addr || mouseStatus.buttons == 0) continue;
+    mouseSender.getInput().updateButtons(mouseStatus.buttons, 0);
+    mouseStatus.buttons = 0;
+  }
+  mouseSender.requestFlush();
+}
+
+bool getReportKey(NimBLERemoteCharacteristic* pRemoteCharacteristic, std::pair<NimBLEAddress, reportID_t>& key) {
+  key.first = pRemoteCharacteristic->getRemoteService()->getClient()->getPeerAddress();
+  return findCachedReport(key.first, pRemoteCharacteristic->getHandle(), key.second, nullptr);
+}
+
+// Tracks the connection-event timing of the link a report arrived on. The latest active mouse decides the phase of the PS/2 packets.
+void trackLinkPhase(MouseStatus& mouseStatus, std::int64_t arrivalMicros) {
+  mouseStatus.linkPhase.addArrival(arrivalMicros);
+  if (mouseStatus.linkPhase.isLocked()) {
+    mouseSender.setLinkPhase(mouseStatus.linkPhase.getAnchorMicros(), mouseStatus.linkPhase.getIntervalMicros());
+  }
+}
+
+// Merges a relative mouse report into the single PS/2 mouse.
+void mergeMouseReport(MouseStatus& mouseStatus, MouseReport& currentHidReport) {
+  mouseStatus.transform.apply(currentHidReport);
+
+  // Merge into the single PS/2 mouse. Wheels are merged in whole detents since each mouse may have its own resolution.
+  const auto wheelResolution = mouseStatus.wheelResolution.load();
+  mouseStatus.wheelVertical += currentHidReport.wheelVertical;
+  mouseStatus.wheelHorizontal += currentHidReport.wheelHorizontal;
+  auto& input = mouseSender.getInput();
+  input.addMotion(currentHidReport.x, currentHidReport.y, takeWholeDetents(mouseStatus.wheelVertical, wheelResolution),
+                  takeWholeDetents(mouseStatus.wheelHorizontal, wheelResolution));
+  const auto buttons = getButtonBits(currentHidReport);
+  input.updateButtons(mouseStatus.buttons, buttons);
+  mouseStatus.buttons = buttons;
+
+  if (input.hasPending()) {
+    mouseSender.requestFlush();
+  }
+}
+
 void IRAM_ATTR notifyCallbackMouseHIDReport(NimBLERemoteCharacteristic* pRemoteCharacteristic, uint8_t* pData, size_t length,
                                             bool isNotify) {
-  constexpr auto MinPs2ReportIntervalMicros = 16667UL;
-
-  const auto addr = pRemoteCharacteristic->getRemoteService()->getClient()->getPeerAddress();
-  const auto handle = pRemoteCharacteristic->getHandle();
-  const auto reportID = HandleReportIDMapCache[addr][handle];
-  const auto reportMap = ReportMapCache[addr];
-  const auto reportItemList = reportMap->getInputReportItemList(reportID);
-  auto currentHidReport = decodeMouseInputReport(pData, *reportItemList);
-  const auto currentTimeMicros = micros();
+  const auto arrivalMicros = esp_timer_get_time();
+  std::pair<NimBLEAddress, reportID_t> key;
+  if (!getReportKey(pRemoteCharacteristic, key)) {
+    return;
+  }
+  touchLinkActivity(key.first, arrivalMicros);
+  std::lock_guard<std::mutex> lock(ReportStatusMutex);
+  auto mouseStatusIt = MouseStatusMap.find(key);
+  if (mouseStatusIt == MouseStatusMap.end()) {
+    return;
+  }
+  auto& mouseStatus = mouseStatusIt->second;
+  trackLinkPhase(mouseStatus, arrivalMicros);
+  if (length < mouseStatus.layout.byteLength) {
+    PS2BLE_LOGE(fmt::format("Mouse report too short: {} < {}", length, mouseStatus.layout.byteLength));
+    return;
+  }
+  auto currentHidReport = decodeMouseInputReport(pData, mouseStatus.layout);
   PS2BLE_LOGV(currentHidReport.toString());
+  mergeMouseReport(mouseStatus, currentHidReport);
+}
 
-  // Initialize mouse status if not initialized.
-  if (MouseStatusMap.find({addr, reportID}) == MouseStatusMap.end()) {
-    MouseStatusMap[{addr, reportID}] = MouseStatus();
+void IRAM_ATTR notifyCallbackDigitizerHIDReport(NimBLERemoteCharacteristic* pRemoteCharacteristic, uint8_t* pData, size_t length,
+                                                bool isNotify) {
+  const auto arrivalMicros = esp_timer_get_time();
+  std::pair<NimBLEAddress, reportID_t> key;
+  if (!getReportKey(pRemoteCharacteristic, key)) {
+    return;
   }
+  touchLinkActivity(key.first, arrivalMicros);
+  std::lock_guard<std::mutex> lock(ReportStatusMutex);
+  auto mouseStatusIt = MouseStatusMap.find(key);
+  auto trackerIt = DigitizerTrackerMap.find(key);
+  if (mouseStatusIt == MouseStatusMap.end() || trackerIt == DigitizerTrackerMap.end()) {
+    return;
+  }
+  auto& mouseStatus = mouseStatusIt->second;
+  trackLinkPhase(mouseStatus, arrivalMicros);
+  auto& tracker = trackerIt->second;
+  const auto& layout = tracker.getLayout();
+  if (length < layout.byteLength) {
+    PS2BLE_LOGE(fmt::format("Digitizer report too short: {} < {}", length, layout.byteLength));
+    return;
+  }
+  auto digitizerReport = decodeDigitizerInputReport(pData, layout);
+  PS2BLE_LOGV(digitizerReport.toString());
+  MouseReport currentHidReport;
+  if (tracker.update(digitizerReport, currentHidReport)) {
+    mergeMouseReport(mouseStatus, currentHidReport);
+  }
+}
 
-  // Load mouse status.
-  auto& mouseStatus = MouseStatusMap[{addr, reportID}];
-  // const auto lastPs2ReportTimeMicros = mouseStatus.lastPs2ReportTimeMicros;
+// GATT data of bonded devices is stored in NVS as "<address>RM" (report map) and "<address>RR" (report references), so
+// reconnecting, also after a reboot, does not read it again. Both are dropped when the device indicates Service Changed.
+bool readReportMapFromNVS(const NimBLEAddress& addr) {
+  auto key = stripColon(addr.toString() + "RM");
+  auto length = NVS.getBlobSize(key.c_str());
+  if (length == 0) {
+    return false;
+  }
+  std::vector<std::uint8_t> rawReportMap(length);
+  if (!NVS.getBlob(key.c_str(), rawReportMap.data(), length)) {
+    return false;
+  }
+  auto reportMap = std::make_shared<ReportMap>(rawReportMap.data(), length);
+  std::lock_guard<std::mutex> lock(GattCacheMutex);
+  ReportMapCache[addr] = reportMap;
+  return true;
+}
 
-  bool sendPs2Report = false;
+void saveReportMapToNVS(const NimBLEAddress& addr, const std::uint8_t* rawReportMap, size_t length) {
+  if (!NimBLEDevice::isBonded(addr)) {
+    return;
+  }
+  auto key = stripColon(addr.toString() + "RM");
+  auto ok = NVS.setBlob(key.c_str(), const_cast<std::uint8_t*>(rawReportMap), length);
+  if (!ok) {
+    PS2BLE_LOGE("Failed to save report map to NVS");
+  }
+}
 
-  do {
-    // If enough time has passed since last PS/2 report, send PS/2 report.
-    if (currentTimeMicros > mouseStatus.lastPs2ReportTimeMicros + MinPs2ReportIntervalMicros) {
-      sendPs2Report = true;
-      break;
-    }
+bool readReportReferencesFromNVS(const NimBLEAddress& addr, HandleReportReferenceMap& map) {
+  auto key = stripColon(addr.toString() + "RR");
+  auto length = NVS.getBlobSize(key.c_str());
+  if (length == 0) {
+    return false;
+  }
+  std::vector<std::uint8_t> data(length);
+  if (!NVS.getBlob(key.c_str(), data.data(), length)) {
+    return false;
+  }
+  return decodeHandleReportReferenceMap(data.data(), length, map);
+}
 
-    // If last report is full, send PS/2 report.
-    if (mouseStatus.hidReportBuf.full()) {
-      sendPs2Report = true;
-      break;
-    }
+void saveReportReferencesToNVS(const NimBLEAddress& addr, const HandleReportReferenceMap& map) {
+  if (!NimBLEDevice::isBonded(addr) || map.empty()) {
+    return;
+  }
+  auto key = stripColon(addr.toString() + "RR");
+  auto data = encodeHandleReportReferenceMap(map);
+  auto ok = NVS.setBlob(key.c_str(), data.data(), data.size());
+  if (!ok) {
+    PS2BLE_LOGE("Failed to save report references to NVS");
+  }
+}
 
-    // If HID report buffer is not empty, compare last HID report with current HID report.
-    if (!mouseStatus.hidReportBuf.empty()) {
-      const auto& lastHidReport = mouseStatus.hidReportBuf.back();
-      // Check if button state is changed since last report.
-      auto isButtonChanged = false;
-      constexpr auto PS2ButtonCount = 5;
-      for (size_t i = 0; i < PS2ButtonCount; i++) {
-        if (currentHidReport.isButtonPressed[i] != lastHidReport.isButtonPressed[i]) {
-          isButtonChanged = true;
-          break;
-        }
-      }
-      if (isButtonChanged) {
-        sendPs2Report = true;
-        break;
-      }
-      // Check if wheel count is changed since last report.
-      if (currentHidReport.wheelVertical != lastHidReport.wheelVertical) {
-        sendPs2Report = true;
-        break;
-      }
+void eraseGattCacheFromNVS(const NimBLEAddress& addr) {
+  NVS.erase(stripColon(addr.toString() + "RM").c_str());
+  NVS.erase(stripColon(addr.toString() + "RR").c_str());
+}
+
+// Drops the cached GATT data of a device from NVS and RAM, so the next connection discovers it again. A report map still
+// in use by a setup task or a callback is freed when they release it.
+void invalidateGattCache(const NimBLEAddress& addr) {
+  eraseGattCacheFromNVS(addr);
+  std::lock_guard<std::mutex> lock(GattCacheMutex);
+  ReportMapCache.erase(addr);
+  ReportReferenceCache.erase(addr);
+}
+
+bool isGattCacheValid(const NimBLEAddress& addr) {
+  std::lock_guard<std::mutex> lock(GattCacheMutex);
+  return ReportMapCache.find(addr) != ReportMapCache.end() && ReportReferenceCache.find(addr) != ReportReferenceCache.end();
+}
+
+// State of a long read of the report map, shared with the NimBLE host task.
+class ReportMapRead {
+ public:
+  ReportMapParser parser;
+  std::vector<std::uint8_t>& rawReportMap;
+  TaskHandle_t task;
+  int status = 0;
+
+  ReportMapRead(ReportMap& reportMap, std::vector<std::uint8_t>& rawReportMap)
+      : parser(reportMap), rawReportMap(rawReportMap), task(xTaskGetCurrentTaskHandle()) {}
+};
+
+// Called by the NimBLE host task for each Read Blob response, and once more when the read ends.
+int onReportMapChunk(uint16_t connHandle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg) {
+  auto read = static_cast<ReportMapRead*>(arg);
+  if (error->status == 0 && attr != nullptr) {
+    for (auto om = attr->om; om != nullptr; om = SLIST_NEXT(om, om_next)) {
+      read->parser.feed(om->om_data, om->om_len);
+      read->rawReportMap.insert(read->rawReportMap.end(), om->om_data, om->om_data + om->om_len);
     }
-  } while (false);
+    return 0;
+  }
+  read->status = error->status == BLE_HS_EDONE ? 0 : error->status;
+  xTaskNotifyGive(read->task);
+  return 0;
+}
 
-  // If PS/2 report is needed, send PS/2 report.
-  if (sendPs2Report) {
-    for (auto& hidReport : mouseStatus.hidReportBuf) {
-      currentHidReport.x += hidReport.x;
-      currentHidReport.y += hidReport.y;
+// Reads the report map with a long read and parses each chunk as it arrives, so parsing overlaps the transfer instead of
+// waiting for the whole value. The raw bytes are kept only to be stored in NVS.
+bool readReportMap(NimBLEClient* client, NimBLERemoteCharacteristic* characteristic, ReportMap& reportMap,
+                   std::vector<std::uint8_t>& rawReportMap) {
+  ReportMapRead read(reportMap, rawReportMap);
+  for (auto isRetry : {false, true}) {
+    auto rc = ble_gattc_read_long(client->getConnId(), characteristic->getHandle(), 0, onReportMapChunk, &read);
+    if (rc != 0) {
+      PS2BLE_LOGE(fmt::format("ble_gattc_read_long failed: {}", rc));
+      return false;
     }
-    mouse.send_report(currentHidReport.x, -currentHidReport.y, currentHidReport.wheelVertical, currentHidReport.isButtonPressed[0],
-                      currentHidReport.isButtonPressed[1], currentHidReport.isButtonPressed[2], currentHidReport.isButtonPressed[3],
-                      currentHidReport.isButtonPressed[4]);
-    mouseStatus.hidReportBuf.clear();
-  } else {
-    // If PS/2 report is not needed, push HID report to buffer.
-    mouseStatus.hidReportBuf.push_back(currentHidReport);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    // The report map needs an encrypted link, so a device which is not paired yet rejects the first chunk.
+    auto isSecurityError = read.status == BLE_HS_ERR_ATT_BASE + BLE_ATT_ERR_INSUFFICIENT_AUTHEN ||
+                           read.status == BLE_HS_ERR_ATT_BASE + BLE_ATT_ERR_INSUFFICIENT_ENC;
+    if (!isSecurityError || isRetry || !rawReportMap.empty() || !client->secureConnection()) {
+      break;
+    }
+  }
+  if (read.status != 0) {
+    PS2BLE_LOGE(fmt::format("Report map read failed: {}", read.status));
+    return false;
+  }
+  if (!read.parser.isAtItemBoundary()) {
+    PS2BLE_LOGW("Report map ends within an item");
   }
+  PS2BLE_LOGI(fmt::format("Read report map: {} bytes, MTU: {}", rawReportMap.size(), client->getMTU()));
+  return true;
+}
+
+std::shared_ptr<ReportMap> getCachedReportMap(const NimBLEAddress& addr) {
+  std::lock_guard<std::mutex> lock(GattCacheMutex);
+  auto it = ReportMapCache.find(addr);
+  return it != ReportMapCache.end() ? it->second : nullptr;
+}
+
+HandleReportReferenceMap getCachedReportReferences(const NimBLEAddress& addr) {
+  std::lock_guard<std::mutex> lock(GattCacheMutex);
+  auto it = ReportReferenceCache.find(addr);
+  return it != ReportReferenceCache.end() ? it->second : HandleReportReferenceMap();
 }
 
 void cacheReportMap(NimBLEClient* client, NimBLERemoteService* service) {
-  auto isReportMapCached = ReportMapCache.find(client->getPeerAddress()) != ReportMapCache.end();
-  if (!isReportMapCached) {
-    PS2BLE_LOGI("Caching report map");
-    auto characteristic = service->getCharacteristic(CUUID_HID_REPORT_MAP);
-    if (characteristic != nullptr) {
-      auto value = characteristic->readValue();
-      auto rawReportMap = value.data();
-      auto rawReportMapLength = value.length();
-      auto reportMap = new ReportMap(rawReportMap, rawReportMapLength);
-      ReportMapCache[client->getPeerAddress()] = reportMap;
-    }
-    PS2BLE_LOGI("Cached report map");
-  } else {
+  auto addr = client->getPeerAddress();
+  if (getCachedReportMap(addr) != nullptr) {
     PS2BLE_LOGI("Report map already cached");
+    return;
   }
+  if (readReportMapFromNVS(addr)) {
+    PS2BLE_LOGI("Report map read from NVS");
+    return;
+  }
+  PS2BLE_LOGI("Caching report map");
+  auto characteristic = service->getCharacteristic(CUUID_HID_REPORT_MAP);
+  if (characteristic != nullptr) {
+    auto reportMap = std::make_shared<ReportMap>();
+    std::vector<std::uint8_t> rawReportMap;
+    if (!readReportMap(client, characteristic, *reportMap, rawReportMap)) {
+      PS2BLE_LOGE("Failed to read report map");
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(GattCacheMutex);
+      ReportMapCache[addr] = reportMap;
+    }
+    saveReportMapToNVS(addr, rawReportMap.data(), rawReportMap.size());
+  }
+  PS2BLE_LOGI("Cached report map");
+}
+
+bool hasAllHandles(const HandleReportReferenceMap& map, const std::vector<NimBLERemoteCharacteristic*>& characteristicsHidReport) {
+  return std::all_of(characteristicsHidReport.begin(), characteristicsHidReport.end(),
+                     [&map](NimBLERemoteCharacteristic* c) { return map.find(c->getHandle()) != map.end(); });
 }
 
-void cacheHandleReportIDMap(NimBLEClient* client, const std::vector<NimBLERemoteCharacteristic*>& characteristicsHidReport) {
-  auto isHandleReportIDMapCached = HandleReportIDMapCache.find(client->getPeerAddress()) != HandleReportIDMapCache.end();
-  if (!isHandleReportIDMapCached) {
-    HandleReportIDMap handleReportIDMap;
-    for (auto& c : characteristicsHidReport) {
-      auto handle = c->getHandle();
-      auto desc = c->getDescriptor(NimBLEUUID(DUUID_HID_REPORT_REFERENCE));
-      auto value = desc->readValue();
-      if (value.size() != 2) continue;
-      auto reportId = value[0];
-      handleReportIDMap[handle] = reportId;
+void cacheReportReferences(NimBLEClient* client, const std::vector<NimBLERemoteCharacteristic*>& characteristicsHidReport) {
+  auto addr = client->getPeerAddress();
+  {
+    std::lock_guard<std::mutex> lock(GattCacheMutex);
+    if (ReportReferenceCache.find(addr) != ReportReferenceCache.end()) {
+      return;
     }
-    HandleReportIDMapCache[client->getPeerAddress()] = handleReportIDMap;
   }
+  HandleReportReferenceMap map;
+  if (readReportReferencesFromNVS(addr, map) && hasAllHandles(map, characteristicsHidReport)) {
+    PS2BLE_LOGI("Report references read from NVS");
+    std::lock_guard<std::mutex> lock(GattCacheMutex);
+    ReportReferenceCache[addr] = map;
+    return;
+  }
+  map.clear();
+  for (auto& c : characteristicsHidReport) {
+    auto desc = c->getDescriptor(NimBLEUUID(DUUID_HID_REPORT_REFERENCE));
+    if (desc == nullptr) continue;
+    auto value = desc->readValue();
+    if (value.size() != 2) continue;
+    map[c->getHandle()] = ReportReference{value[0], value[1]};
+  }
+  {
+    std::lock_guard<std::mutex> lock(GattCacheMutex);
+    ReportReferenceCache[addr] = map;
+  }
+  saveReportReferencesToNVS(addr, map);
 }
 
 std::vector<NimBLERemoteCharacteristic*> getHIDReportCharacteristics(NimBLERemoteService* service) {
-  auto characteristics = service->getCharacteristics(true);
+  // Characteristics kept from the previous connection are reused, see taskConnect.
+  auto characteristics = service->getCharacteristics(false);
+  if (characteristics->empty()) {
+    characteristics = service->getCharacteristics(true);
+  }
   auto characteristicsHidReport = std::vector<NimBLERemoteCharacteristic*>();
   for (auto& c : *characteristics) {
     if (c->getUUID() == NimBLEUUID(CUUID_HID_REPORT_DATA)) {
@@ -618,8 +1588,12 @@ void subscribeToReport(NimBLEClient* client, NimBLERemoteCharacteristic* charact
       usagePage == static_cast<usagePage_t>(UsagePage::CONSUMER) && usageID == static_cast<usageID_t>(UsageIDConsumer::CONSUMERCONTROL);
   auto isMouse =
       usagePage == static_cast<usagePage_t>(UsagePage::GENERIC_DESKTOP) && usageID == static_cast<usageID_t>(UsageIDGenericDesktop::MOUSE);
+  auto isDigitizer = usagePage == static_cast<usagePage_t>(UsagePage::DIGITIZER) &&
+                     (usageID == static_cast<usageID_t>(UsageIDDigitizer::DIGITIZER) ||
+                      usageID == static_cast<usageID_t>(UsageIDDigitizer::PEN) || usageID == static_cast<usageID_t>(UsageIDDigitizer::TOUCH_PAD));
 
   if (isKeyboard || isConsumerControl) {
+    initKeyboardStatus(client->getPeerAddress(), reportId);
     auto ok = characteristic->subscribe(true, notifyCallbackKeyboardHIDReport);
     if (ok) {
       PS2BLE_LOGI(fmt::format("Subscribed to reportID: {}", reportId));
@@ -629,6 +1603,7 @@ void subscribeToReport(NimBLEClient* client, NimBLERemoteCharacteristic* charact
   }
 
   if (isMouse) {
+    initMouseStatus(client->getPeerAddress(), reportItemList);
     auto ok = characteristic->subscribe(true, notifyCallbackMouseHIDReport);
     if (ok) {
       PS2BLE_LOGI(fmt::format("Subscribed to reportID: {}", reportId));
@@ -636,17 +1611,31 @@ void subscribeToReport(NimBLEClient* client, NimBLERemoteCharacteristic* charact
       PS2BLE_LOGE(fmt::format("Failed to subscribe to reportID: {}", reportId));
     }
   }
+
+  if (isDigitizer) {
+    initDigitizerStatus(client->getPeerAddress(), reportItemList);
+    auto ok = characteristic->subscribe(true, notifyCallbackDigitizerHIDReport);
+    if (ok) {
+      PS2BLE_LOGI(fmt::format("Subscribed to reportID: {}", reportId));
+    } else {
+      PS2BLE_LOGE(fmt::format("Failed to subscribe to reportID: {}", reportId));
+    }
+  }
 }
 
 void subscribeHIDReportCharacteristics(NimBLEClient* client, const std::vector<NimBLERemoteCharacteristic*>& characteristicsHidReport) {
+  auto reportReferences = getCachedReportReferences(client->getPeerAddress());
+  auto reportMap = getCachedReportMap(client->getPeerAddress());
+  if (reportMap == nullptr) {
+    PS2BLE_LOGE("Report map not cached");
+    return;
+  }
   for (auto& c : characteristicsHidReport) {
-    auto desc = c->getDescriptor(NimBLEUUID(DUUID_HID_REPORT_REFERENCE));
-    auto value = desc->readValue();
-    if (value.size() != 2) continue;
-    auto reportId = value[0];
-    auto reportType = value[1];
+    auto it = reportReferences.find(c->getHandle());
+    if (it == reportReferences.end()) continue;
+    auto reportId = it->second.reportID;
+    auto reportType = it->second.reportType;
     if (reportType != ESP_HID_REPORT_TYPE_INPUT) continue;
-    auto reportMap = ReportMapCache[client->getPeerAddress()];
     auto inputReportItemLists = reportMap->getInputReportItemLists();
     for (auto& inputReportItemList : inputReportItemLists) {
       auto reportItemList = inputReportItemList.second;
@@ -657,7 +1646,70 @@ void subscribeHIDReportCharacteristics(NimBLEClient* client, const std::vector<N
   }
 }
 
-void subscribeToHIDService(NimBLEClient* client) {
+// Sets the Resolution Multiplier feature report to its maximum on mice which support it, so wheels report fractional detents.
+void enableHighResolutionScroll(NimBLEClient* client, const std::vector<NimBLERemoteCharacteristic*>& characteristicsHidReport) {
+  auto addr = client->getPeerAddress();
+  auto reportMap = getCachedReportMap(addr);
+  ResolutionMultiplierReport resolutionMultiplierReport;
+  if (reportMap == nullptr || !buildResolutionMultiplierReport(*reportMap, resolutionMultiplierReport)) {
+    return;
+  }
+  auto reportReferences = getCachedReportReferences(addr);
+  for (auto& c : characteristicsHidReport) {
+    auto it = reportReferences.find(c->getHandle());
+    if (it == reportReferences.end()) continue;
+    auto reportId = it->second.reportID;
+    auto reportType = it->second.reportType;
+    if (reportType != ESP_HID_REPORT_TYPE_FEATURE || reportId != resolutionMultiplierReport.reportID) continue;
+    auto ok = c->writeValue(resolutionMultiplierReport.data.data(), resolutionMultiplierReport.data.size(), true);
+    if (!ok) {
+      PS2BLE_LOGE(fmt::format("Failed to set resolution multiplier of reportID: {}", reportId));
+      return;
+    }
+    std::lock_guard<std::mutex> lock(ReportStatusMutex);
+    // Only mouse reports with a wheel scale with the multiplier. Digitizers keep their fixed scroll distance per detent.
+    for (auto& [key, mouseStatus] : MouseStatusMap) {
+      const auto& layout = mouseStatus.layout;
+      if (key.first != addr || DigitizerTrackerMap.count(key) != 0) continue;
+      if (layout.wheelVertical.bitSize == 0 && layout.wheelHorizontal.bitSize == 0) continue;
+      mouseStatus.wheelResolution = resolutionMultiplierReport.multiplier;
+    }
+    PS2BLE_LOGI(fmt::format("Resolution multiplier set to {}", resolutionMultiplierReport.multiplier));
+    return;
+  }
+}
+
+const char SERVICE_UUID_GENERIC_ATTRIBUTE[] = "1801";
+const char CHARACTERISTIC_UUID_SERVICE_CHANGED[] = "2A05";
+
+// The attribute handles of the device changed, so the cached GATT data is dropped and the device is reconnected, which
+// discovers it again.
+void indicateCallbackServiceChanged(NimBLERemoteCharacteristic* pRemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify) {
+  auto client = pRemoteCharacteristic->getRemoteService()->getClient();
+  auto addr = client->getPeerAddress();
+  PS2BLE_LOGI(fmt::format("Service Changed indicated by {}, dropping cached GATT data", addr.toString()));
+  invalidateGattCache(addr);
+  client->disconnect();
+}
+
+void subscribeToServiceChanged(NimBLEClient* client) {
+  auto service = client->getService(SERVICE_UUID_GENERIC_ATTRIBUTE);
+  if (service == nullptr) {
+    return;
+  }
+  auto characteristic = service->getCharacteristic(CHARACTERISTIC_UUID_SERVICE_CHANGED);
+  if (characteristic == nullptr) {
+    return;
+  }
+  if (!characteristic->subscribe(false, indicateCallbackServiceChanged)) {
+    PS2BLE_LOGE("Failed to subscribe to Service Changed");
+  }
+}
+
+// Sets up a connected device in one pass over its services. Each attribute is discovered and read at most once, input
+// reports are subscribed back to back before anything else is written or read, and the rest, which input does not
+// depend on, follows.
+void setUpConnection(NimBLEClient* client, ConnectionSetupTimer& timer) {
   NimBLERemoteService* service = client->getService(CUUID_HID_SERVICE);
   if (service == nullptr) {
     PS2BLE_LOGI("HID service not found");
@@ -665,9 +1717,16 @@ void subscribeToHIDService(NimBLEClient* client) {
     return;
   }
   cacheReportMap(client, service);
+  timer.mark("report map");
   auto characteristicsHidReport = getHIDReportCharacteristics(service);
-  cacheHandleReportIDMap(client, characteristicsHidReport);
+  cacheReportReferences(client, characteristicsHidReport);
+  timer.mark("report references");
   subscribeHIDReportCharacteristics(client, characteristicsHidReport);
+  timer.mark("subscribe");
+  enableHighResolutionScroll(client, characteristicsHidReport);
+  subscribeToServiceChanged(client);
+  saveDeviceInfoToNVS(client);
+  timer.mark("other");
 }
 
 bool getResetCount(std::uint8_t* resetCount) {
@@ -716,8 +1775,55 @@ bool shouldRestorePs2InternalState() {
   }
 }
 
+// The byte interval learned for each PS/2 port is stored in NVS, 0 (not stored) starts from the default, see
+// PS2BLE_PS2_BYTE_INTERVAL_AUTO_CALIBRATION.
+constexpr auto NVS_KEY_MOUSE_BYTE_INTERVAL = "mouseByteIntvl";
+constexpr auto NVS_KEY_KEYBOARD_BYTE_INTERVAL = "kbdByteIntvl";
+
+std::uint32_t readByteIntervalFromNVS(const char* key) { return NVS.getInt(key); }
+
+void saveByteIntervalToNVS(const char* key, std::uint32_t intervalMicros) {
+  auto ok = NVS.setInt(key, intervalMicros);
+  if (!ok) {
+    PS2BLE_LOGE(fmt::format("Failed to write {} to NVS", key));
+  }
+}
+
+// Host-set PS/2 state, written from loop() at most once per loop period when it changed.
+constexpr auto NVS_KEY_PS2_HOST_STATE = "ps2HostState";
+Ps2HostState SavedPs2HostState;
+
+bool readPs2HostStateFromNVS(Ps2HostState& state) {
+  auto ok = NVS.getBlob(NVS_KEY_PS2_HOST_STATE, reinterpret_cast<std::uint8_t*>(&state), sizeof(state));
+  return ok && state.isValid();
+}
+
+void savePs2HostStateIfChanged() {
+  auto state = SavedPs2HostState;
+  if (!mousePort.captureHostState(state) || state == SavedPs2HostState) {
+    return;
+  }
+  auto ok = NVS.setBlob(NVS_KEY_PS2_HOST_STATE, reinterpret_cast<std::uint8_t*>(&state), sizeof(state));
+  if (!ok) {
+    PS2BLE_LOGE("Failed to write PS/2 host state to NVS");
+    return;
+  }
+  SavedPs2HostState = state;
+  PS2BLE_LOGI(fmt::format("Saved PS/2 host state to NVS: sample rate {}, mouse type {}, reporting {}", state.mouseSampleRate,
+                          state.mouseType, state.isMouseReportingEnabled));
+}
+
+void saveLearnedByteIntervals() {
+  std::uint32_t intervalMicros;
+  if (mousePort.getByteIntervalControl().takeUnsavedInterval(intervalMicros)) {
+    saveByteIntervalToNVS(NVS_KEY_MOUSE_BYTE_INTERVAL, intervalMicros);
+  }
+  if (keyboardPort.getByteIntervalControl().takeUnsavedInterval(intervalMicros)) {
+    saveByteIntervalToNVS(NVS_KEY_KEYBOARD_BYTE_INTERVAL, intervalMicros);
+  }
+}
+
 void taskMouseBegin(void* arg) {
-  mouse.set_byte_interval_micros(60);
   if (shouldRestorePs2InternalState()) {
     PS2BLE_LOGI("taskMouseBegin: restoring internal state");
     mouse.begin(true);
@@ -795,23 +1901,32 @@ void apiBegin() {
   // handle GET to list bonded devices
   server.on("/api/bonded-devices", HTTP_GET, [](AsyncWebServerRequest* request) {
     auto doc = DynamicJsonDocument(4096);
-    auto bondedDevices = doc.createNestedArray("bondedDevices");
-    auto bondedNum = NimBLEDevice::getNumBonds();
-    for (size_t i = 0; i < bondedNum; i++) {
-      auto addr = NimBLEDevice::getBondedAddress(i);
-      auto addrStr = std::string(addr);
-      auto addrType = addr.getType();
-      auto key = stripColon(addrStr);
-      auto name = readDeviceNameFromNVS(addr);
-      auto appearance = getAppearanceName(readAppearanceFromNVS(addr));
-      auto clinet = NimBLEDevice::getClientByPeerAddress(addr);
-      auto isConnected = clinet != nullptr && clinet->isConnected();
-      auto bondedDevice = bondedDevices.createNestedObject();
-      bondedDevice["address"] = addrStr;
-      bondedDevice["addressType"] = addrType;
-      bondedDevice["name"] = name;
-      bondedDevice["appearance"] = appearance;
-      bondedDevice["isConnected"] = isConnected;
+    auto ok = runBleCommand(
+        [&doc]() {
+          auto bondedDevices = doc.createNestedArray("bondedDevices");
+          auto bondedNum = NimBLEDevice::getNumBonds();
+          for (size_t i = 0; i < bondedNum; i++) {
+            auto addr = NimBLEDevice::getBondedAddress(i);
+            auto addrStr = std::string(addr);
+            auto addrType = addr.getType();
+            auto key = stripColon(addrStr);
+            auto name = readDeviceNameFromNVS(addr);
+            auto appearance = getAppearanceName(readAppearanceFromNVS(addr));
+            auto clinet = NimBLEDevice::getClientByPeerAddress(addr);
+            auto isConnected = clinet != nullptr && clinet->isConnected();
+            auto bondedDevice = bondedDevices.createNestedObject();
+            bondedDevice["address"] = addrStr;
+            bondedDevice["addressType"] = addrType;
+            bondedDevice["name"] = name;
+            bondedDevice["appearance"] = appearance;
+            bondedDevice["isConnected"] = isConnected;
+            bondedDevice["pinned"] = readPinnedFromNVS(addr);
+          }
+        },
+        BLE_COMMAND_WEB_TIMEOUT_TICKS);
+    if (!ok) {
+      request->send(503, "application/json", "{\"message\":\"BLE is busy\"}");
+      return;
     }
     String output;
     serializeJson(doc, output);
@@ -826,17 +1941,78 @@ void apiBegin() {
     auto addrStr = jsonObj["address"].as<String>();
     auto addrType = jsonObj["addressType"].as<std::uint8_t>();
     auto addr = NimBLEAddress(addrStr.c_str(), addrType);
-    if (NimBLEDevice::isBonded(addr)) {
-      PS2BLE_LOGI(fmt::format("Deleting bond for {}", std::string(addr)));
-      auto ok = NimBLEDevice::deleteBond(addr);
-      if (ok) {
-        response["deleted"] = true;
-      } else {
-        response["message"] = "Failed to delete bond";
-      }
+    auto ok = runBleCommand(
+        [&]() {
+          if (NimBLEDevice::isBonded(addr)) {
+            PS2BLE_LOGI(fmt::format("Deleting bond for {}", std::string(addr)));
+            auto isDeleted = NimBLEDevice::deleteBond(addr);
+            if (isDeleted) {
+              invalidateGattCache(addr);
+              NVS.erase(stripColon(addr.toString() + "PN").c_str());
+              rebuildBondedAddresses();
+              xEventGroupSetBits(xEventGroupScan, SCAN_EVENT_LINKS_CHANGED);
+              response["deleted"] = true;
+            } else {
+              response["message"] = "Failed to delete bond";
+            }
+          } else {
+            PS2BLE_LOGI(fmt::format("Bond not found for {}", std::string(addr)));
+            response["message"] = "Bond not found";
+          }
+        },
+        BLE_COMMAND_WEB_TIMEOUT_TICKS);
+    if (!ok) {
+      response["message"] = "BLE is busy";
+    }
+    String responseStr;
+    serializeJson(response, responseStr);
+    request->send(200, "application/json", responseStr);
+  });
+  server.addHandler(handler);
+  // handle POST to set mouse settings of a bonded device
+  handler = new AsyncCallbackJsonWebHandler("/api/bonded-devices/mouse-settings", [](AsyncWebServerRequest* request, JsonVariant& json) {
+    StaticJsonDocument<256> response;
+    response["ok"] = false;
+    response["message"] = "";
+    const JsonObject& jsonObj = json.as<JsonObject>();
+    auto addrStr = jsonObj["address"].as<String>();
+    auto addrType = jsonObj["addressType"].as<std::uint8_t>();
+    auto addr = NimBLEAddress(addrStr.c_str(), addrType);
+    auto scalePercent = jsonObj["scalePercent"].as<std::uint16_t>();
+    auto isAccelerationEnabled = jsonObj["acceleration"].as<bool>();
+    auto isBonded = isBondedAddress(addr);
+    if (scalePercent == 0 || scalePercent > 1000) {
+      response["message"] = "Invalid scale";
+    } else if (!isBonded) {
+      response["message"] = "Bond not found";
+    } else if (!saveMouseSettingsToNVS(addr, scalePercent, isAccelerationEnabled)) {
+      response["message"] = "Failed to save mouse settings";
     } else {
-      PS2BLE_LOGI(fmt::format("Bond not found for {}", std::string(addr)));
+      response["ok"] = true;
+      response["message"] = "Applied on next connection";
+    }
+    String responseStr;
+    serializeJson(response, responseStr);
+    request->send(200, "application/json", responseStr);
+  });
+  server.addHandler(handler);
+  // handle POST to pin a bonded device, so it always gets a connection slot
+  handler = new AsyncCallbackJsonWebHandler("/api/bonded-devices/pin", [](AsyncWebServerRequest* request, JsonVariant& json) {
+    StaticJsonDocument<256> response;
+    response["ok"] = false;
+    response["message"] = "";
+    const JsonObject& jsonObj = json.as<JsonObject>();
+    auto addrStr = jsonObj["address"].as<String>();
+    auto addrType = jsonObj["addressType"].as<std::uint8_t>();
+    auto addr = NimBLEAddress(addrStr.c_str(), addrType);
+    auto isPinned = jsonObj["pinned"].as<bool>();
+    auto isBonded = isBondedAddress(addr);
+    if (!isBonded) {
       response["message"] = "Bond not found";
+    } else if (!savePinnedToNVS(addr, isPinned)) {
+      response["message"] = "Failed to save pinned state";
+    } else {
+      response["ok"] = true;
     }
     String responseStr;
     serializeJson(response, responseStr);
@@ -846,7 +2022,7 @@ void apiBegin() {
   // handle GET to get scan mode
   server.on("/api/scan-mode", HTTP_GET, [](AsyncWebServerRequest* request) {
     auto doc = DynamicJsonDocument(256);
-    doc["scanMode"] = static_cast<std::uint8_t>(DEFAULT_SCAN_MODE);
+    doc["scanMode"] = static_cast<std::uint8_t>(getScanMode());
     String output;
     serializeJson(doc, output);
     request->send(200, "application/json", output);
@@ -859,32 +2035,15 @@ void apiBegin() {
     const JsonObject& jsonObj = json.as<JsonObject>();
     auto scanMode = jsonObj["scanMode"].as<std::uint8_t>();
 
-    auto currentScanMode = DEFAULT_SCAN_MODE;
-    auto ret = xQueuePeek(xQueueScanMode, &currentScanMode, 0);
-    if (ret != pdTRUE) {
-      PS2BLE_LOGE("xQueuePeek failed for xQueueScanMode");
-    }
-
-    if (currentScanMode == ScanMode::Disabled) {
-      PS2BLE_LOGI("Scan disabled, do not overwrite scan mode");
-      response["message"] = "Scan disabled";
+    // Connecting pauses the scan separately, so the mode can be changed at any time.
+    auto isScanModeValid = isValidScanMode(scanMode);
+    if (!isScanModeValid) {
+      PS2BLE_LOGE(fmt::format("Invalid scan mode: {}", scanMode));
+      response["message"] = "Invalid scan mode";
     } else {
-      PS2BLE_LOGI("Scan enabled, overwrite scan mode");
-      auto isScanModeValid = isValidScanMode(scanMode);
-      if (!isScanModeValid) {
-        PS2BLE_LOGE(fmt::format("Invalid scan mode: {}", scanMode));
-        response["message"] = "Invalid scan mode";
-      } else {
-        xQueueReset(xQueueLastConnectedDevice);
-        auto mode = static_cast<ScanMode>(scanMode);
-        ret = xQueueOverwrite(xQueueScanMode, &mode);
-        if (ret != pdTRUE) {
-          PS2BLE_LOGE("xQueueOverwrite failed for xQueueScanMode");
-          response["message"] = "Failed to overwrite scan mode";
-        } else {
-          response["ok"] = true;
-        }
-      }
+      xQueueReset(xQueueLastConnectedDevice);
+      setScanMode(static_cast<ScanMode>(scanMode));
+      response["ok"] = true;
     }
 
     String responseStr;
@@ -915,6 +2074,12 @@ void apiBegin() {
     serializeJson(doc, output);
     request->send(200, "application/json", output);
   });
+  // handle POST to recalibrate the PS/2 byte intervals
+  server.on("/api/ps2-byte-interval/calibrate", HTTP_POST, [](AsyncWebServerRequest* request) {
+    mousePort.getByteIntervalControl().requestCalibration();
+    keyboardPort.getByteIntervalControl().requestCalibration();
+    request->send(200, "application/json", "{\"ok\":true}");
+  });
   // handle GET to fetch frontend files
   server.serveStatic("/", LittleFS, "/").setDefaultFile("index.html").setCacheControl("public,max-age=31536000");
   server.begin();
@@ -955,15 +2120,33 @@ void setup() {
   // Increment reset counter
   incrementResetCount();
 
-  xTaskCreateUniversal(taskMouseBegin, "taskMouseBegin", 4096, nullptr, 1, nullptr, CONFIG_ARDUINO_RUNNING_CORE);
-  xTaskCreateUniversal(taskKeyboardBegin, "taskKeyboardBegin", 4096, nullptr, 1, nullptr, CONFIG_ARDUINO_RUNNING_CORE);
+  if (readPs2HostStateFromNVS(SavedPs2HostState)) {
+    PS2BLE_LOGI(fmt::format("Restored PS/2 host state: sample rate {}, mouse type {}, reporting {}", SavedPs2HostState.mouseSampleRate,
+                            SavedPs2HostState.mouseType, SavedPs2HostState.isMouseReportingEnabled));
+    mousePort.restoreHostState(SavedPs2HostState);
+  } else {
+    SavedPs2HostState = Ps2HostState();
+  }
+  mousePort.getByteIntervalControl().begin(mouse, readByteIntervalFromNVS(NVS_KEY_MOUSE_BYTE_INTERVAL));
+  keyboardPort.getByteIntervalControl().begin(keyboard, readByteIntervalFromNVS(NVS_KEY_KEYBOARD_BYTE_INTERVAL));
+  if (!keyboardPort.begin()) {
+    PS2BLE_LOGE("Failed to start PS/2 keyboard transmitter");
+  }
+  if (!mouseSender.begin()) {
+    PS2BLE_LOGE("Failed to start PS/2 mouse sender");
+  }
+  xTaskCreateUniversal(taskMouseBegin, "taskMouseBegin", 4096, nullptr, PS2BLE_PS2_TASK_PRIORITY, nullptr, PS2BLE_PS2_TASK_CORE);
+  xTaskCreateUniversal(taskKeyboardBegin, "taskKeyboardBegin", 4096, nullptr, PS2BLE_PS2_TASK_PRIORITY, nullptr, PS2BLE_PS2_TASK_CORE);
 
   PS2BLE_LOGI("Starting NimBLE HID Client");
   NimBLEDevice::init("ps2ble");
   NimBLEDevice::setSecurityIOCap(BLE_HS_IO_NO_INPUT_OUTPUT);
   NimBLEDevice::setSecurityAuth(true, true, true);
   NimBLEDevice::setPower(ESP_PWR_LVL_P9);
+  // Exchanged by NimBLE right after each connection is established.
+  NimBLEDevice::setMTU(PS2BLE_BLE_MTU);
 
+  rebuildBondedAddresses();
   // print bonded devices
   auto bondedNum = NimBLEDevice::getNumBonds();
   PS2BLE_LOGI(fmt::format("Number of bonded devices: {}", bondedNum));
@@ -973,6 +2156,10 @@ void setup() {
     PS2BLE_LOGI(fmt::format("Bonded device {}: {}", i, addrStr));
   }
 
+  // Before the web server and taskConnect, which send it commands.
+  xQueueBleCommand = xQueueCreate(4, sizeof(BleCommand*));
+  xTaskCreateUniversal(taskBleCommand, "taskBleCommand", 4096, nullptr, PS2BLE_BLE_TASK_PRIORITY, nullptr, PS2BLE_BLE_TASK_CORE);
+
   // If reset counter is 5, start SoftAP and Web interface.
   ok = getResetCount(&resetCount);
   if (!ok) {
@@ -995,19 +2182,21 @@ void setup() {
     timerAlarmEnable(timer);
   }
 
-  xQueueScanMode = xQueueCreate(1, sizeof(ScanMode));
-  xQueueDeviceToConnect = xQueueCreate(9, sizeof(NimBLEAdvertisedDevice*));
+  xEventGroupScan = xEventGroupCreate();
   xQueueLastConnectedDevice = xQueueCreate(1, sizeof(NimBLEAddress));
-
-  xTaskCreateUniversal(taskScan, "taskScan", 4096, nullptr, 1, nullptr, CONFIG_ARDUINO_RUNNING_CORE);
-  xTaskCreateUniversal(taskConnect, "taskConnect", 4096, nullptr, 1, nullptr, CONFIG_ARDUINO_RUNNING_CORE);
-
-  auto mode = DEFAULT_SCAN_MODE;
-  auto ret = xQueueOverwrite(xQueueScanMode, &mode);
-  if (ret != pdTRUE) {
-    PS2BLE_LOGE("xQueueOverwrite failed for xQueueScanMode");
+  xSemaphoreLinkDisconnected = xSemaphoreCreateBinary();
+  xQueueConnectionSetup = xQueueCreate(CONFIG_BT_NIMBLE_MAX_CONNECTIONS, sizeof(ConnectionSetup*));
+
+  // taskConnect first, as the scan callbacks notify it.
+  xTaskCreateUniversal(taskConnect, "taskConnect", 4096, nullptr, PS2BLE_BLE_TASK_PRIORITY, &taskConnectHandle, PS2BLE_BLE_TASK_CORE);
+  xTaskCreateUniversal(taskScan, "taskScan", 4096, nullptr, PS2BLE_BLE_TASK_PRIORITY, nullptr, PS2BLE_BLE_TASK_CORE);
+  for (int i = 0; i < PS2BLE_CONNECTION_SETUP_TASKS; i++) {
+    xTaskCreateUniversal(taskSetUpConnection, "taskSetUpConnection", 4096, nullptr, PS2BLE_BLE_TASK_PRIORITY, nullptr,
+                         PS2BLE_BLE_TASK_CORE);
   }
 
+  setScanMode(DEFAULT_SCAN_MODE);
+
   ledOn();
 
   // clear reset counter
@@ -1017,6 +2206,11 @@ void setup() {
 
 void loop() {
   delay(10000);
+  // Written here instead of from the senders, which must not block on flash
+  saveLearnedByteIntervals();
+  savePs2HostStateIfChanged();
+  PS2BLE_LOGD(fmt::format("PS/2 mouse: {}", mousePort.getCountersString()));
+  PS2BLE_LOGD(fmt::format("PS/2 keyboard: {}", keyboardPort.getCountersString()));
   // Monitor memory usage for debugging
   PS2BLE_LOGD(
       fmt::format("Free heap: {}/{} ({:.2f}%)", ESP.getFreeHeap(), ESP.getHeapSize(), ESP.getFreeHeap() * 100.0 / ESP.getHeapSize()));
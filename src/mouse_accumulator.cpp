@@ -0,0 +1,198 @@
+#include "mouse_accumulator.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// Clamps value into [min, max] and returns the part which did not fit.
+std::int32_t saturate(std::int32_t& value, std::int32_t min, std::int32_t max) {
+  auto clamped = std::clamp(value, min, max);
+  auto remainder = value - clamped;
+  value = clamped;
+  return remainder;
+}
+
+// Limits the carried remainder and returns the number of counts dropped.
+std::uint32_t limitCarry(std::int32_t& remainder, std::int32_t limit) {
+  auto limited = std::clamp(remainder, -limit, limit);
+  auto dropped = static_cast<std::uint32_t>(std::abs(remainder - limited));
+  remainder = limited;
+  return dropped;
+}
+
+std::int32_t sign(std::int32_t value) { return (value > 0) - (value < 0); }
+
+}  // namespace
+
+std::size_t Ps2MousePacket::encode(Ps2MouseType type, std::uint8_t (&bytes)[PS2_MOUSE_PACKET_MAX_LENGTH]) const {
+  // Bit 3 is always set, bits 4 and 5 are the 9th (sign) bits of X and Y. Motion is already within range, so the overflow
+  // bits stay clear.
+  bytes[0] = static_cast<std::uint8_t>(isButtonPressed[0] | isButtonPressed[1] << 1 | isButtonPressed[2] << 2 | 0x08 | (x < 0) << 4 |
+                                       (y < 0) << 5);
+  bytes[1] = static_cast<std::uint8_t>(x);
+  bytes[2] = static_cast<std::uint8_t>(y);
+  switch (type) {
+    case Ps2MouseType::Generic:
+      return 3;
+    case Ps2MouseType::IntelliMouse:
+      bytes[3] = static_cast<std::uint8_t>(wheel);
+      return 4;
+    case Ps2MouseType::IntelliMouseExplorer:
+      bytes[3] = static_cast<std::uint8_t>((wheel & 0x0F) | isButtonPressed[3] << 4 | isButtonPressed[4] << 5);
+      return 4;
+  }
+  return 3;
+}
+
+std::string Ps2MousePacket::toString() const {
+  return fmt::format("Ps2MousePacket {{x: {}, y: {}, wheel: {}, isButtonPressed: [{}, {}, {}, {}, {}], isSaturated: {}}}", x, y, wheel,
+                     isButtonPressed[0], isButtonPressed[1], isButtonPressed[2], isButtonPressed[3], isButtonPressed[4], isSaturated);
+}
+
+std::uint8_t getButtonBits(const MouseReport& report) {
+  std::uint8_t bits = 0;
+  for (std::size_t i = 0; i < PS2_MOUSE_BUTTON_COUNT; i++) {
+    if (report.isButtonPressed[i]) {
+      bits |= 1 << i;
+    }
+  }
+  return bits;
+}
+
+// MouseAccumulator functions
+
+void MouseAccumulator::addMotion(std::int32_t x, std::int32_t y, std::int32_t wheelVertical, std::int32_t wheelHorizontal) {
+  this->x += x;
+  this->y -= y;  // HID Y axis points down, PS/2 Y axis points up
+  this->wheelVertical += wheelVertical;
+  this->wheelHorizontal += wheelHorizontal;
+}
+
+void MouseAccumulator::updateButtons(std::uint8_t buttons, std::uint8_t pressed, std::uint8_t released) {
+  this->buttons = buttons;
+  pressedSinceLastPacket |= pressed;
+  releasedSinceLastPacket |= released;
+}
+
+bool MouseAccumulator::hasPending() const {
+  return x != 0 || y != 0 || wheelVertical != 0 || wheelHorizontal != 0 || buttons != lastSentButtons || pressedSinceLastPacket != 0 ||
+         releasedSinceLastPacket != 0;
+}
+
+Ps2MousePacket MouseAccumulator::takePacket(Ps2MouseType type) {
+  Ps2MousePacket packet;
+  auto packetX = x;
+  auto packetY = y;
+  x = saturate(packetX, PS2_MOTION_MIN, PS2_MOTION_MAX);
+  y = saturate(packetY, PS2_MOTION_MIN, PS2_MOTION_MAX);
+
+  std::int32_t packetWheel = 0;
+  switch (type) {
+    case Ps2MouseType::Generic:
+      wheelVertical = 0;
+      wheelHorizontal = 0;
+      break;
+    case Ps2MouseType::IntelliMouse:
+      packetWheel = std::clamp(wheelVertical, PS2_WHEEL_MIN, PS2_WHEEL_MAX);
+      wheelVertical -= packetWheel;
+      wheelHorizontal = 0;
+      break;
+    case Ps2MouseType::IntelliMouseExplorer:
+      // +/-1 is vertical and +/-2 is horizontal, so one detent of one axis is sent per packet.
+      if (wheelVertical != 0) {
+        packetWheel = sign(wheelVertical);
+        wheelVertical -= packetWheel;
+      } else if (wheelHorizontal != 0) {
+        packetWheel = sign(wheelHorizontal) * PS2_HORIZONTAL_WHEEL_STEP;
+        wheelHorizontal -= sign(wheelHorizontal);
+      }
+      break;
+  }
+
+  packet.isSaturated = x != 0 || y != 0 || wheelVertical != 0 || wheelHorizontal != 0;
+  if (packet.isSaturated) {
+    counters.saturatedPacketCount++;
+    counters.droppedCount += limitCarry(x, PS2_MOTION_MAX * MAX_CARRY_PACKETS);
+    counters.droppedCount += limitCarry(y, PS2_MOTION_MAX * MAX_CARRY_PACKETS);
+    counters.carriedCount += std::abs(x) + std::abs(y);
+    limitCarry(wheelVertical, PS2_WHEEL_MAX * MAX_CARRY_PACKETS);
+    limitCarry(wheelHorizontal, PS2_WHEEL_MAX * MAX_CARRY_PACKETS);
+  }
+  counters.packetCount++;
+
+  // Flip the buttons whose press or release was undone since the last packet; the next packet sends the current state.
+  auto hiddenPresses = pressedSinceLastPacket & ~lastSentButtons & ~buttons;
+  auto hiddenReleases = releasedSinceLastPacket & lastSentButtons & buttons;
+  auto packetButtons = buttons ^ (hiddenPresses | hiddenReleases);
+  pressedSinceLastPacket = 0;
+  releasedSinceLastPacket = 0;
+  lastSentButtons = packetButtons;
+
+  packet.x = packetX;
+  packet.y = packetY;
+  packet.wheel = packetWheel;
+  for (std::size_t i = 0; i < PS2_MOUSE_BUTTON_COUNT; i++) {
+    packet.isButtonPressed[i] = packetButtons & (1 << i);
+  }
+  return packet;
+}
+
+const MouseAccumulatorCounters& MouseAccumulator::getCounters() const { return counters; }
+
+// MouseInputMerger functions
+
+std::uint8_t MouseInputMerger::getButtons(std::uint32_t counters) const {
+  std::uint8_t buttons = 0;
+  for (std::size_t i = 0; i < PS2_MOUSE_BUTTON_COUNT; i++) {
+    if ((counters >> (i * BUTTON_COUNTER_BITS)) & BUTTON_COUNTER_MASK) {
+      buttons |= 1 << i;
+    }
+  }
+  return buttons;
+}
+
+void MouseInputMerger::addMotion(std::int32_t x, std::int32_t y, std::int32_t wheelVertical, std::int32_t wheelHorizontal) {
+  if (x == 0 && y == 0 && wheelVertical == 0 && wheelHorizontal == 0) {
+    return;
+  }
+  this->x.fetch_add(x, std::memory_order_relaxed);
+  this->y.fetch_add(y, std::memory_order_relaxed);
+  this->wheelVertical.fetch_add(wheelVertical, std::memory_order_relaxed);
+  this->wheelHorizontal.fetch_add(wheelHorizontal, std::memory_order_relaxed);
+  hasPendingInput.store(true, std::memory_order_release);
+}
+
+void MouseInputMerger::updateButtons(std::uint8_t previous, std::uint8_t current) {
+  std::uint8_t newlyPressed = current & ~previous;
+  std::uint8_t newlyReleased = previous & ~current;
+  if (newlyPressed == 0 && newlyReleased == 0) {
+    return;
+  }
+  for (std::size_t i = 0; i < PS2_MOUSE_BUTTON_COUNT; i++) {
+    std::uint32_t one = 1u << (i * BUTTON_COUNTER_BITS);
+    if (newlyPressed & (1 << i)) {
+      buttonCounters.fetch_add(one, std::memory_order_relaxed);
+    } else if (newlyReleased & (1 << i)) {
+      buttonCounters.fetch_sub(one, std::memory_order_relaxed);
+    }
+  }
+  pressed.fetch_or(newlyPressed, std::memory_order_relaxed);
+  released.fetch_or(newlyReleased, std::memory_order_relaxed);
+  hasPendingInput.store(true, std::memory_order_release);
+}
+
+bool MouseInputMerger::hasPending() const { return hasPendingInput.load(std::memory_order_acquire); }
+
+void MouseInputMerger::drainInto(MouseAccumulator& accumulator) {
+  // Clear the flag first, so input added while draining is picked up by the next drain.
+  if (!hasPendingInput.exchange(false, std::memory_order_acquire)) {
+    return;
+  }
+  accumulator.addMotion(x.exchange(0, std::memory_order_relaxed), y.exchange(0, std::memory_order_relaxed),
+                        wheelVertical.exchange(0, std::memory_order_relaxed), wheelHorizontal.exchange(0, std::memory_order_relaxed));
+  accumulator.updateButtons(getButtons(buttonCounters.load(std::memory_order_relaxed)), pressed.exchange(0, std::memory_order_relaxed),
+                            released.exchange(0, std::memory_order_relaxed));
+}
@@ -0,0 +1,113 @@
+#ifndef A7C37F98_0524_4D97_96A8_E2E025D2190F
+#define A7C37F98_0524_4D97_96A8_E2E025D2190F
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "hid/mouse.hpp"
+
+constexpr std::size_t PS2_MOUSE_BUTTON_COUNT = 5;
+constexpr std::size_t PS2_MOUSE_PACKET_MAX_LENGTH = 4;
+
+// Packet format enabled by the host through the IntelliMouse sample rate sequences.
+enum class Ps2MouseType {
+  Generic,               // 3-byte packet, no wheel
+  IntelliMouse,          // 4-byte packet, vertical wheel (-8..7)
+  IntelliMouseExplorer,  // 4-byte packet, 4-bit wheel and buttons 4 and 5
+};
+
+// A PS/2 mouse packet. Y axis is already converted to the PS/2 direction (positive is up).
+class Ps2MousePacket {
+ public:
+  std::int16_t x = 0;
+  std::int16_t y = 0;
+  std::int8_t wheel = 0;  // Z field as sent, horizontal detents are encoded as +/-2 in IntelliMouse Explorer mode
+  bool isButtonPressed[PS2_MOUSE_BUTTON_COUNT] = {false};
+  bool isSaturated = false;  // Some motion did not fit and was carried to the next packet
+  // Writes the bytes sent on the wire in the packet format and returns their number.
+  std::size_t encode(Ps2MouseType type, std::uint8_t (&bytes)[PS2_MOUSE_PACKET_MAX_LENGTH]) const;
+  std::string toString() const;
+};
+
+class MouseAccumulatorCounters {
+ public:
+  std::uint32_t packetCount = 0;
+  std::uint32_t saturatedPacketCount = 0;  // Packets clamped to the PS/2 range
+  std::uint32_t carriedCount = 0;          // Motion counts carried to a later packet
+  std::uint32_t droppedCount = 0;          // Motion counts dropped because the carry limit was exceeded
+};
+
+// Returns the pressed buttons of a HID report as a bitmask (bit 0 is the left button).
+std::uint8_t getButtonBits(const MouseReport& report);
+
+// Accumulates mouse input between PS/2 packets.
+// PS/2 packets carry 9-bit motion (-256..255) and a 4-bit wheel (-8..7), while BLE mice report up to 16-bit deltas.
+// Motion which does not fit into one packet is carried into the next packets instead of being wrapped or lost.
+// This class is not thread safe; it is owned by the PS/2 mouse sender.
+class MouseAccumulator {
+ public:
+  static constexpr std::int32_t PS2_MOTION_MIN = -256;
+  static constexpr std::int32_t PS2_MOTION_MAX = 255;
+  static constexpr std::int32_t PS2_WHEEL_MIN = -8;
+  static constexpr std::int32_t PS2_WHEEL_MAX = 7;
+  static constexpr std::int8_t PS2_HORIZONTAL_WHEEL_STEP = 2;
+  // Bounds the carried motion to this many full packets, 40 ms at 200 reports/s, so a flick faster than PS/2 can carry does
+  // not keep the cursor moving after the hand stopped. Motion beyond it is dropped and counted in droppedCount.
+  // A 16000 DPI mouse reaches the PS/2 limit of 51000 counts/s at about 3 inches/s (see test/test_mouse_accumulator).
+  static constexpr std::int32_t MAX_CARRY_PACKETS = 8;
+
+ private:
+  std::int32_t x = 0;
+  std::int32_t y = 0;
+  std::int32_t wheelVertical = 0;    // In detents
+  std::int32_t wheelHorizontal = 0;  // In detents
+  std::uint8_t buttons = 0;
+  std::uint8_t pressedSinceLastPacket = 0;
+  std::uint8_t releasedSinceLastPacket = 0;
+  std::uint8_t lastSentButtons = 0;
+  MouseAccumulatorCounters counters;
+
+ public:
+  // Adds motion in HID orientation and wheel movement in whole detents.
+  void addMotion(std::int32_t x, std::int32_t y, std::int32_t wheelVertical, std::int32_t wheelHorizontal);
+  // Sets the current button state. Presses and releases which were undone before the next packet are kept, so a quick click
+  // is sent as a press in one packet and a release in the next instead of being lost.
+  void updateButtons(std::uint8_t buttons, std::uint8_t pressed, std::uint8_t released);
+  bool hasPending() const;
+  // Takes the next PS/2 packet for the given packet format. Motion outside the PS/2 range stays pending for the next packet.
+  // Wheels the format cannot carry are discarded.
+  Ps2MousePacket takePacket(Ps2MouseType type);
+  const MouseAccumulatorCounters& getCounters() const;
+};
+
+// Merge point of all BLE mice. Written lock-free from the notify callbacks and drained by the single PS/2 mouse sender,
+// so the host sees one mouse with summed motion and OR'ed buttons no matter how many pointing devices are connected.
+class MouseInputMerger {
+ public:
+  // Each button has a counter of devices pressing it, packed into one atomic word.
+  static constexpr int BUTTON_COUNTER_BITS = 6;
+  static constexpr std::uint32_t BUTTON_COUNTER_MASK = (1 << BUTTON_COUNTER_BITS) - 1;
+
+ private:
+  std::atomic<std::int32_t> x{0};
+  std::atomic<std::int32_t> y{0};
+  std::atomic<std::int32_t> wheelVertical{0};
+  std::atomic<std::int32_t> wheelHorizontal{0};
+  std::atomic<std::uint32_t> buttonCounters{0};
+  std::atomic<std::uint8_t> pressed{0};
+  std::atomic<std::uint8_t> released{0};
+  std::atomic<bool> hasPendingInput{false};
+
+  std::uint8_t getButtons(std::uint32_t counters) const;
+
+ public:
+  void addMotion(std::int32_t x, std::int32_t y, std::int32_t wheelVertical, std::int32_t wheelHorizontal);
+  // Applies the button change of one device. previous must be the state last passed as current for that device.
+  void updateButtons(std::uint8_t previous, std::uint8_t current);
+  bool hasPending() const;
+  // Moves everything merged so far into the accumulator.
+  void drainInto(MouseAccumulator& accumulator);
+};
+
+#endif /* A7C37F98_0524_4D97_96A8_E2E025D2190F */
@@ -0,0 +1,133 @@
+#include "mouse_sender.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+
+#include "logging.hpp"
+
+Ps2MouseSender::Ps2MouseSender(Ps2MousePort& mouse) : mouse(mouse) {}
+
+bool Ps2MouseSender::begin() {
+  auto ret = xTaskCreateUniversal(transmitTask, "mouseTransmit", 4096, this, PS2BLE_PS2_TASK_PRIORITY, &transmitTaskHandle,
+                                  PS2BLE_PS2_TASK_CORE);
+  if (ret != pdPASS) {
+    PS2BLE_LOGE("xTaskCreateUniversal failed for mouse transmit task");
+    transmitTaskHandle = nullptr;
+    return false;
+  }
+  esp_timer_create_args_t args = {};
+  args.callback = flushTimerCallback;
+  args.arg = this;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "mouseFlush";
+  auto err = esp_timer_create(&args, &flushTimer);
+  if (err != ESP_OK) {
+    PS2BLE_LOGE(fmt::format("esp_timer_create failed for mouse flush timer: {}", esp_err_to_name(err)));
+    flushTimer = nullptr;
+    return false;
+  }
+  return true;
+}
+
+MouseInputMerger& Ps2MouseSender::getInput() { return input; }
+
+// Returns the PS/2 report interval derived from the sample rate set by the host with command 0xF3.
+std::int64_t Ps2MouseSender::getReportIntervalMicros() {
+  auto sampleRate = mouse.getSampleRate();
+  if (sampleRate < MIN_PS2_SAMPLE_RATE || sampleRate > MAX_PS2_SAMPLE_RATE) {
+    sampleRate = DEFAULT_PS2_SAMPLE_RATE;
+  }
+  return 1000000LL / sampleRate;
+}
+
+Ps2MouseType Ps2MouseSender::getPs2MouseType() {
+  if (mouse.has4thAnd5thButtons()) {
+    return Ps2MouseType::IntelliMouseExplorer;
+  }
+  if (mouse.hasWheel()) {
+    return Ps2MouseType::IntelliMouse;
+  }
+  return Ps2MouseType::Generic;
+}
+
+void Ps2MouseSender::setLinkPhase(std::int64_t anchorMicros, std::int64_t intervalMicros) {
+  linkAnchorMicros.store(anchorMicros, std::memory_order_relaxed);
+  linkIntervalMicros.store(intervalMicros, std::memory_order_relaxed);
+}
+
+// Returns the earliest time the next packet may be sent.
+// While packets are sent back to back, the send time is delayed by up to a quarter of the report interval so that it
+// falls just after a BLE connection event. The packet then carries the input of that event instead of waiting for the
+// next PS/2 slot, which would add up to one report interval of latency that varies from packet to packet. It is never
+// moved earlier, so packets stay at least one report interval apart.
+std::int64_t Ps2MouseSender::getNextPacketTimeMicros(std::int64_t intervalMicros) {
+  auto nominalMicros = lastPacketTimeMicros.load(std::memory_order_relaxed) + intervalMicros;
+  return alignToLinkPhase(nominalMicros, intervalMicros, linkAnchorMicros.load(std::memory_order_relaxed),
+                          linkIntervalMicros.load(std::memory_order_relaxed), LINK_PHASE_GUARD_MICROS);
+}
+
+void Ps2MouseSender::requestFlush() {
+  auto delayMicros = getNextPacketTimeMicros(getReportIntervalMicros()) - esp_timer_get_time();
+  armFlushTimer(std::max<std::int64_t>(delayMicros, 0));
+}
+
+void Ps2MouseSender::armFlushTimer(std::int64_t delayMicros) {
+  if (flushTimer == nullptr || isFlushTimerArmed.exchange(true)) {
+    return;
+  }
+  auto err = esp_timer_start_once(flushTimer, delayMicros);
+  if (err != ESP_OK) {
+    PS2BLE_LOGE(fmt::format("esp_timer_start_once failed for mouse flush timer: {}", esp_err_to_name(err)));
+    isFlushTimerArmed.store(false);
+  }
+}
+
+void Ps2MouseSender::flushTimerCallback(void* arg) {
+  auto sender = static_cast<Ps2MouseSender*>(arg);
+  sender->isFlushTimerArmed.store(false);
+  xTaskNotifyGive(sender->transmitTaskHandle);
+}
+
+void Ps2MouseSender::transmitTask(void* arg) {
+  auto sender = static_cast<Ps2MouseSender*>(arg);
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    sender->flush();
+  }
+}
+
+void Ps2MouseSender::flush() {
+  const auto intervalMicros = getReportIntervalMicros();
+  const auto now = esp_timer_get_time();
+  // The timer may have been armed against an older packet time, so enforce the pacing here as well.
+  const auto nextPacketTimeMicros = getNextPacketTimeMicros(intervalMicros);
+  if (now < nextPacketTimeMicros) {
+    armFlushTimer(nextPacketTimeMicros - now);
+    return;
+  }
+
+  // Responses to host commands go first.
+  if (!mouse.isReadyToSend()) {
+    armFlushTimer(COMMAND_RESPONSE_WAIT_MICROS);
+    return;
+  }
+
+  input.drainInto(accumulator);
+  if (!accumulator.hasPending()) {
+    return;
+  }
+  auto packet = accumulator.takePacket(getPs2MouseType());
+  lastPacketTimeMicros.store(now, std::memory_order_relaxed);
+  mouse.sendReport(packet);
+  if (packet.isSaturated) {
+    PS2BLE_LOGD(fmt::format("Mouse motion saturated, packets: {}/{}, carried: {}, dropped: {}",
+                            accumulator.getCounters().saturatedPacketCount, accumulator.getCounters().packetCount,
+                            accumulator.getCounters().carriedCount, accumulator.getCounters().droppedCount));
+  }
+
+  // Remainders and input which arrived while sending go out with the next packet.
+  if (accumulator.hasPending() || input.hasPending()) {
+    armFlushTimer(std::max<std::int64_t>(getNextPacketTimeMicros(intervalMicros) - now, 0));
+  }
+}
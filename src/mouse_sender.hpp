@@ -0,0 +1,58 @@
+#ifndef ECBE5137_13AE_4A55_B0A9_3DCD3BC87929
+#define ECBE5137_13AE_4A55_B0A9_3DCD3BC87929
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <cstdint>
+
+#include "link_phase.hpp"
+#include "mouse_accumulator.hpp"
+#include "ps2_port.hpp"
+#include "task_plan.hpp"
+extern "C" {
+#include <esp_timer.h>
+}
+
+constexpr std::uint8_t DEFAULT_PS2_SAMPLE_RATE = 100;  // Reports per second after PS/2 reset
+constexpr std::uint8_t MIN_PS2_SAMPLE_RATE = 10;
+constexpr std::uint8_t MAX_PS2_SAMPLE_RATE = 200;
+constexpr std::int64_t LINK_PHASE_GUARD_MICROS = 300;        // Time after a connection event for the notify callback to run
+constexpr std::int64_t COMMAND_RESPONSE_WAIT_MICROS = 1000;  // Retry interval while the mouse answers a host command
+
+// The single sender of PS/2 mouse packets.
+// BLE notify callbacks merge their input into getInput() and call requestFlush(). Packets are sent from one transmit task on
+// the PS/2 core, woken by an esp_timer paced to the sample rate the host set with command 0xF3, so the packet rate and the
+// cost per packet do not depend on the number of connected mice. The timer only wakes the task because esp_timer callbacks
+// run on the BLE core.
+class Ps2MouseSender {
+ private:
+  Ps2MousePort& mouse;
+  MouseInputMerger input;
+  MouseAccumulator accumulator;  // Only touched from the transmit task
+  esp_timer_handle_t flushTimer = nullptr;
+  TaskHandle_t transmitTaskHandle = nullptr;
+  std::atomic<bool> isFlushTimerArmed{false};
+  std::atomic<std::int64_t> lastPacketTimeMicros{0};
+  std::atomic<std::int64_t> linkAnchorMicros{0};
+  std::atomic<std::int64_t> linkIntervalMicros{0};
+
+  static void flushTimerCallback(void* arg);
+  static void transmitTask(void* arg);
+  void flush();
+  void armFlushTimer(std::int64_t delayMicros);
+  Ps2MouseType getPs2MouseType();
+  std::int64_t getNextPacketTimeMicros(std::int64_t intervalMicros);
+
+ public:
+  explicit Ps2MouseSender(Ps2MousePort& mouse);
+  bool begin();
+  MouseInputMerger& getInput();
+  // Schedules a packet at the next slot allowed by the host's sample rate.
+  void requestFlush();
+  std::int64_t getReportIntervalMicros();
+  // Sets the connection-event timing of the BLE link that mouse input arrives on, see LinkPhaseEstimator.
+  void setLinkPhase(std::int64_t anchorMicros, std::int64_t intervalMicros);
+};
+
+#endif /* ECBE5137_13AE_4A55_B0A9_3DCD3BC87929 */
@@ -0,0 +1,54 @@
+#include "mouse_transform.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// Multiplies value by a Q16.16 factor, adding and updating the carried fraction.
+std::int32_t scaleWithRemainder(std::int32_t value, fixed16_t factor, fixed16_t& remainder) {
+  auto scaled = static_cast<std::int64_t>(value) * factor + remainder;
+  auto integer = static_cast<std::int32_t>(scaled >> FIXED16_SHIFT);  // Arithmetic shift rounds toward negative infinity
+  remainder = static_cast<fixed16_t>(scaled - (static_cast<std::int64_t>(integer) << FIXED16_SHIFT));
+  return integer;
+}
+
+}  // namespace
+
+MotionTransform::MotionTransform(const MotionTransformConfig& config) : config(config) {}
+
+const MotionTransformConfig& MotionTransform::getConfig() const { return config; }
+
+void MotionTransform::setConfig(const MotionTransformConfig& config) {
+  this->config = config;
+  reset();
+}
+
+bool MotionTransform::isIdentity() const { return config.scale == FIXED16_ONE && !config.isAccelerationEnabled; }
+
+void MotionTransform::reset() {
+  remainderX = 0;
+  remainderY = 0;
+}
+
+fixed16_t MotionTransform::getFactor(std::int32_t x, std::int32_t y) const {
+  if (!config.isAccelerationEnabled) {
+    return config.scale;
+  }
+  // Octagonal approximation of the vector length: max + min / 2.
+  auto absX = std::abs(x);
+  auto absY = std::abs(y);
+  auto speed = std::max(absX, absY) + std::min(absX, absY) / 2;
+  auto index = std::min<std::size_t>(speed >> config.accelerationSpeedShift, MotionTransformConfig::ACCELERATION_TABLE_SIZE - 1);
+  auto gain = config.accelerationTable[index];
+  return static_cast<fixed16_t>((static_cast<std::int64_t>(config.scale) * gain) >> GAIN8_SHIFT);
+}
+
+void MotionTransform::apply(MouseReport& report) {
+  if (isIdentity()) {
+    return;
+  }
+  auto factor = getFactor(report.x, report.y);
+  report.x = scaleWithRemainder(report.x, factor, remainderX);
+  report.y = scaleWithRemainder(report.y, factor, remainderY);
+}
@@ -0,0 +1,70 @@
+#ifndef CE990C92_B57E_47CB_968B_A76F19FD482F
+#define CE990C92_B57E_47CB_968B_A76F19FD482F
+
+#include <array>
+#include <cstdint>
+
+#include "hid/mouse.hpp"
+
+#ifndef PS2BLE_MOUSE_SCALE_PERCENT
+#define PS2BLE_MOUSE_SCALE_PERCENT 100
+#endif
+
+#ifndef PS2BLE_MOUSE_ACCELERATION
+#define PS2BLE_MOUSE_ACCELERATION 0
+#endif
+
+// Fixed point helpers. Scale factors are Q16.16, acceleration gains are Q8.8.
+using fixed16_t = std::int32_t;
+using gain8_t = std::uint16_t;
+constexpr int FIXED16_SHIFT = 16;
+constexpr fixed16_t FIXED16_ONE = 1 << FIXED16_SHIFT;
+constexpr int GAIN8_SHIFT = 8;
+constexpr gain8_t GAIN8_ONE = 1 << GAIN8_SHIFT;
+
+constexpr fixed16_t percentToFixed16(std::uint32_t percent) { return static_cast<fixed16_t>((percent << FIXED16_SHIFT) / 100); }
+
+class MotionTransformConfig {
+ public:
+  static constexpr std::size_t ACCELERATION_TABLE_SIZE = 16;
+  // Speed (counts per HID report) covered by one acceleration table entry is 1 << accelerationSpeedShift.
+  using AccelerationTable = std::array<gain8_t, ACCELERATION_TABLE_SIZE>;
+
+  fixed16_t scale = percentToFixed16(PS2BLE_MOUSE_SCALE_PERCENT);
+  bool isAccelerationEnabled = PS2BLE_MOUSE_ACCELERATION;
+  std::uint8_t accelerationSpeedShift = 1;
+  AccelerationTable accelerationTable = defaultAccelerationTable();
+
+  // Gain rises linearly from 1.0 at rest to 2.0 at 30 counts per report.
+  static constexpr AccelerationTable defaultAccelerationTable() {
+    AccelerationTable table = {};
+    for (std::size_t i = 0; i < ACCELERATION_TABLE_SIZE; i++) {
+      table[i] = GAIN8_ONE + GAIN8_ONE * i / (ACCELERATION_TABLE_SIZE - 1);
+    }
+    return table;
+  }
+};
+
+// Per-device motion transform applied between decodeMouseInputReport and the PS/2 accumulator.
+// Only integer arithmetic is used. The fractional part of each axis is carried to the next report,
+// so slow movements are not quantized away when the scale is below 1.0.
+class MotionTransform {
+ private:
+  MotionTransformConfig config;
+  fixed16_t remainderX = 0;
+  fixed16_t remainderY = 0;
+
+  fixed16_t getFactor(std::int32_t x, std::int32_t y) const;
+
+ public:
+  MotionTransform() = default;
+  explicit MotionTransform(const MotionTransformConfig& config);
+  const MotionTransformConfig& getConfig() const;
+  void setConfig(const MotionTransformConfig& config);
+  // Returns true if the transform leaves motion unchanged, so apply() can skip it.
+  bool isIdentity() const;
+  void apply(MouseReport& report);
+  void reset();
+};
+
+#endif /* CE990C92_B57E_47CB_968B_A76F19FD482F */
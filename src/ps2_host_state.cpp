@@ -0,0 +1,14 @@
+#include "ps2_host_state.hpp"
+
+bool Ps2HostState::isValid() const {
+  return version == CURRENT_VERSION && mouseType <= static_cast<std::uint8_t>(Ps2MouseType::IntelliMouseExplorer);
+}
+
+Ps2MouseType Ps2HostState::getMouseType() const { return static_cast<Ps2MouseType>(mouseType); }
+
+bool Ps2HostState::operator==(const Ps2HostState& other) const {
+  return version == other.version && mouseSampleRate == other.mouseSampleRate && mouseType == other.mouseType &&
+         isMouseReportingEnabled == other.isMouseReportingEnabled;
+}
+
+bool Ps2HostState::operator!=(const Ps2HostState& other) const { return !(*this == other); }
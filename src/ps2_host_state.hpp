@@ -0,0 +1,29 @@
+#ifndef ED0D5560_2851_4C3F_A0AC_AA00859B8266
+#define ED0D5560_2851_4C3F_A0AC_AA00859B8266
+
+#include <cstdint>
+
+#include "mouse_accumulator.hpp"
+
+// PS/2 mouse state set by the host with commands, stored in NVS so a rebooted bridge keeps it until the host sends new
+// commands (see Ps2devMousePort::restoreHostState). Stored as a blob, so fields are fixed-size and the version changes
+// whenever the layout does.
+// Only state which changes what the bridge sends is kept. Resolution and scaling are not, since motion is sent as the BLE
+// mouse reports it. Neither is keyboard state: the bridge does not generate typematic repeats and does not forward the LEDs
+// to BLE keyboards, and esp32_ps2dev has no way to set them other than host commands.
+class Ps2HostState {
+ public:
+  static constexpr std::uint8_t CURRENT_VERSION = 1;
+
+  std::uint8_t version = CURRENT_VERSION;
+  std::uint8_t mouseSampleRate = 100;
+  std::uint8_t mouseType = static_cast<std::uint8_t>(Ps2MouseType::Generic);
+  std::uint8_t isMouseReportingEnabled = false;
+
+  bool isValid() const;
+  Ps2MouseType getMouseType() const;
+  bool operator==(const Ps2HostState& other) const;
+  bool operator!=(const Ps2HostState& other) const;
+};
+
+#endif /* ED0D5560_2851_4C3F_A0AC_AA00859B8266 */
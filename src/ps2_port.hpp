@@ -0,0 +1,31 @@
+#ifndef B46F9079_6FEA_45BB_B920_A8D0E72907A1
+#define B46F9079_6FEA_45BB_B920_A8D0E72907A1
+
+#include <cstdint>
+#include <initializer_list>
+
+#include "mouse_accumulator.hpp"
+
+// Thin interfaces over the PS/2 devices for the code which sends input to the host.
+// The firmware implements them with esp32_ps2dev (see ps2dev_port.hpp), misc/ps2_sim with a software model of the wire.
+
+class Ps2MousePort {
+ public:
+  virtual ~Ps2MousePort() = default;
+  // Sample rate set by the host with command 0xF3
+  virtual std::uint8_t getSampleRate() = 0;
+  virtual bool hasWheel() = 0;
+  virtual bool has4thAnd5thButtons() = 0;
+  // False while the device answers a host command, whose response must not wait behind input.
+  virtual bool isReadyToSend() { return true; }
+  virtual void sendReport(const Ps2MousePacket& packet) = 0;
+};
+
+class Ps2KeyboardPort {
+ public:
+  virtual ~Ps2KeyboardPort() = default;
+  // The list may be queued, so its elements must have static storage like the scan code tables.
+  virtual void sendScanCode(const std::initializer_list<std::uint8_t>& scanCode) = 0;
+};
+
+#endif /* B46F9079_6FEA_45BB_B920_A8D0E72907A1 */
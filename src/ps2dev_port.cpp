@@ -0,0 +1,207 @@
+#include "ps2dev_port.hpp"
+
+#include <fmt/core.h>
+
+#include "logging.hpp"
+
+void Ps2ByteIntervalControl::begin(esp32_ps2dev::PS2dev& device, std::uint32_t learnedIntervalMicros) {
+  tuner = ByteIntervalTuner(learnedIntervalMicros);
+  if (PS2BLE_PS2_BYTE_INTERVAL_AUTO_CALIBRATION && !ByteIntervalTuner::isValidInterval(learnedIntervalMicros)) {
+    tuner.startCalibration();
+  }
+  device.set_byte_interval_micros(tuner.getIntervalMicros());
+}
+
+void Ps2ByteIntervalControl::update(esp32_ps2dev::PS2dev& device, std::uint32_t resendRequestCount, bool isInterrupted) {
+  if (isCalibrationRequested.exchange(false)) {
+    tuner.startCalibration();
+  }
+  const auto previousIntervalMicros = tuner.getIntervalMicros();
+  // The host asks for a resend right after a bad byte, so requests since the previous packet are charged to it.
+  auto isLearnedChanged = resendRequestCount != lastResendRequestCount ? tuner.onTransmissionError(Ps2TransmissionError::Resend)
+                          : isInterrupted ? tuner.onTransmissionError(Ps2TransmissionError::Interrupted)
+                                          : tuner.onPacketSent();
+  lastResendRequestCount = resendRequestCount;
+  if (tuner.getIntervalMicros() != previousIntervalMicros) {
+    device.set_byte_interval_micros(tuner.getIntervalMicros());
+  }
+  if (isLearnedChanged) {
+    PS2BLE_LOGI(fmt::format("PS/2 byte interval learned: {} us", tuner.getLearnedIntervalMicros()));
+    unsavedIntervalMicros.store(tuner.getLearnedIntervalMicros());
+  }
+}
+
+void Ps2ByteIntervalControl::requestCalibration() { isCalibrationRequested.store(true); }
+
+bool Ps2ByteIntervalControl::takeUnsavedInterval(std::uint32_t& intervalMicros) {
+  intervalMicros = unsavedIntervalMicros.exchange(0);
+  return intervalMicros != 0;
+}
+
+void Ps2TransferTimer::addTransfer(std::int64_t elapsedMicros, std::size_t byteCount) {
+  if (byteCount == 0) {
+    return;
+  }
+  const auto byteMicros = elapsedMicros / static_cast<std::int64_t>(byteCount);
+  if (byteMicros < minByteMicros.load(std::memory_order_relaxed)) {
+    minByteMicros.store(byteMicros, std::memory_order_relaxed);
+  }
+  if (byteMicros > maxByteMicros.load(std::memory_order_relaxed)) {
+    maxByteMicros.store(byteMicros, std::memory_order_relaxed);
+  }
+}
+
+std::int64_t Ps2TransferTimer::getJitterMicros() const {
+  auto minMicros = minByteMicros.load(std::memory_order_relaxed);
+  auto maxMicros = maxByteMicros.load(std::memory_order_relaxed);
+  return maxMicros >= minMicros ? maxMicros - minMicros : 0;
+}
+
+std::string Ps2TransferTimer::getString() const {
+  return fmt::format("byte time: max {} us, jitter {} us", maxByteMicros.load(std::memory_order_relaxed), getJitterMicros());
+}
+
+Ps2devMousePort::Ps2devMousePort(MonitoredPs2Mouse& mouse) : mouse(mouse) {}
+
+Ps2ByteIntervalControl& Ps2devMousePort::getByteIntervalControl() { return byteIntervalControl; }
+
+void Ps2devMousePort::restoreHostState(const Ps2HostState& state) {
+  restoredHostState = state;
+  hasRestoredHostState = true;
+}
+
+// After a cold boot esp32_ps2dev starts from its defaults, while the host still expects the state it set before.
+bool Ps2devMousePort::isUsingRestoredHostState() { return hasRestoredHostState && mouse.getCommandCount() == 0; }
+
+bool Ps2devMousePort::captureHostState(Ps2HostState& state) {
+  if (mouse.getCommandCount() == 0) {
+    return false;
+  }
+  state.mouseSampleRate = mouse.get_sample_rate();
+  state.mouseType = static_cast<std::uint8_t>(mouse.has_4th_and_5th_buttons() ? Ps2MouseType::IntelliMouseExplorer
+                                              : mouse.has_wheel()             ? Ps2MouseType::IntelliMouse
+                                                                              : Ps2MouseType::Generic);
+  state.isMouseReportingEnabled = mouse.data_reporting_enabled();
+  return true;
+}
+
+std::uint8_t Ps2devMousePort::getSampleRate() {
+  return isUsingRestoredHostState() ? restoredHostState.mouseSampleRate : mouse.get_sample_rate();
+}
+
+bool Ps2devMousePort::hasWheel() {
+  return isUsingRestoredHostState() ? restoredHostState.getMouseType() != Ps2MouseType::Generic : mouse.has_wheel();
+}
+
+bool Ps2devMousePort::has4thAnd5thButtons() {
+  return isUsingRestoredHostState() ? restoredHostState.getMouseType() == Ps2MouseType::IntelliMouseExplorer
+                                    : mouse.has_4th_and_5th_buttons();
+}
+
+bool Ps2devMousePort::isReadyToSend() { return !mouse.isReplyingToHost(); }
+
+// esp32_ps2dev builds packets from its own state, which starts from the defaults after a cold boot: no wheel and
+// reporting disabled. Until the host sends a command, the packets are built here in the restored format and written with
+// the library's byte transfer under its bus lock, so they cannot interleave with a reply to the host. Returns false if a
+// command arrived meanwhile, and the library's state applies again. isInterrupted is set if a byte failed to write or the
+// transfer was stretched by a host inhibit.
+bool Ps2devMousePort::sendRestoredReport(const Ps2MousePacket& packet, bool& isInterrupted) {
+  std::uint8_t bytes[PS2_MOUSE_PACKET_MAX_LENGTH];
+  const auto length = packet.encode(restoredHostState.getMouseType(), bytes);
+  const auto busMutex = mouse.get_bus_mutex_handle();
+  xSemaphoreTake(busMutex, portMAX_DELAY);
+  if (!isUsingRestoredHostState()) {
+    xSemaphoreGive(busMutex);
+    return false;
+  }
+  // Like the mouse the host left, which sends nothing while reporting is disabled.
+  if (restoredHostState.isMouseReportingEnabled) {
+    const auto startMicros = esp_timer_get_time();
+    for (std::size_t i = 0; i < length && !isInterrupted; i++) {
+      isInterrupted = mouse.write(bytes[i]) != 0;
+    }
+    const auto elapsedMicros = esp_timer_get_time() - startMicros;
+    transferTimer.addTransfer(elapsedMicros, length);
+    isInterrupted = isInterrupted || isTransferInterrupted(elapsedMicros, length, mouse.get_byte_interval_micros());
+  }
+  xSemaphoreGive(busMutex);
+  return true;
+}
+
+void Ps2devMousePort::sendReport(const Ps2MousePacket& packet) {
+  mouse.clearResendSequence();
+  auto isInterrupted = false;
+  if (isUsingRestoredHostState() && sendRestoredReport(packet, isInterrupted)) {
+    byteIntervalControl.update(mouse, mouse.getResendRequestCount(), isInterrupted);
+    return;
+  }
+  // esp32_ps2dev does not report failed bytes of a packet, so an interruption is detected from the transfer time.
+  const auto startMicros = esp_timer_get_time();
+  mouse.send_report(packet.x, packet.y, packet.wheel, packet.isButtonPressed[0], packet.isButtonPressed[1], packet.isButtonPressed[2],
+                    packet.isButtonPressed[3], packet.isButtonPressed[4]);
+  const auto elapsedMicros = esp_timer_get_time() - startMicros;
+  const std::size_t length = has4thAnd5thButtons() || hasWheel() ? 4 : 3;
+  transferTimer.addTransfer(elapsedMicros, length);
+  byteIntervalControl.update(mouse, mouse.getResendRequestCount(),
+                             isTransferInterrupted(elapsedMicros, length, mouse.get_byte_interval_micros()));
+}
+
+std::string Ps2devMousePort::getCountersString() const {
+  return fmt::format("commands: {}, max response: {} us, resends: {}, resend limit: {}, {}", mouse.getCommandCount(),
+                     mouse.getMaxResponseMicros(), mouse.getResendRequestCount(), mouse.getResendLimitCount(),
+                     transferTimer.getString());
+}
+
+Ps2devKeyboardPort::Ps2devKeyboardPort(MonitoredPs2Keyboard& keyboard) : keyboard(keyboard) {}
+
+bool Ps2devKeyboardPort::begin() {
+  frameQueue = xQueueCreate(FRAME_QUEUE_LENGTH, sizeof(std::initializer_list<std::uint8_t>));
+  if (frameQueue == nullptr) {
+    PS2BLE_LOGE("xQueueCreate failed for keyboard frame queue");
+    return false;
+  }
+  xTaskCreateUniversal(transmitTask, "keyboardTransmit", 4096, this, PS2BLE_PS2_TASK_PRIORITY, nullptr, PS2BLE_PS2_TASK_CORE);
+  return true;
+}
+
+Ps2ByteIntervalControl& Ps2devKeyboardPort::getByteIntervalControl() { return byteIntervalControl; }
+
+void Ps2devKeyboardPort::sendScanCode(const std::initializer_list<std::uint8_t>& scanCode) {
+  if (frameQueue == nullptr || xQueueSend(frameQueue, &scanCode, 0) != pdTRUE) {
+    droppedFrameCount.fetch_add(1, std::memory_order_relaxed);
+    PS2BLE_LOGE("Keyboard frame queue full, scan code dropped");
+    return;
+  }
+  auto depth = static_cast<std::uint32_t>(uxQueueMessagesWaiting(frameQueue));
+  if (depth > maxQueueDepth.load(std::memory_order_relaxed)) {
+    maxQueueDepth.store(depth, std::memory_order_relaxed);
+  }
+}
+
+void Ps2devKeyboardPort::transmitTask(void* arg) {
+  auto port = static_cast<Ps2devKeyboardPort*>(arg);
+  std::initializer_list<std::uint8_t> scanCode;
+  while (true) {
+    if (xQueueReceive(port->frameQueue, &scanCode, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    while (port->keyboard.isReplyingToHost()) {
+      vTaskDelay(1);
+    }
+    port->keyboard.clearResendSequence();
+    const auto startMicros = esp_timer_get_time();
+    port->keyboard.send_scancode(scanCode);
+    const auto elapsedMicros = esp_timer_get_time() - startMicros;
+    port->transferTimer.addTransfer(elapsedMicros, scanCode.size());
+    port->byteIntervalControl.update(
+        port->keyboard, port->keyboard.getResendRequestCount(),
+        isTransferInterrupted(elapsedMicros, scanCode.size(), port->keyboard.get_byte_interval_micros()));
+  }
+}
+
+std::string Ps2devKeyboardPort::getCountersString() const {
+  return fmt::format("queue: {}/{} (max {}), dropped: {}, commands: {}, max response: {} us, resends: {}, resend limit: {}, {}",
+                     frameQueue != nullptr ? uxQueueMessagesWaiting(frameQueue) : 0, FRAME_QUEUE_LENGTH, maxQueueDepth.load(),
+                     droppedFrameCount.load(), keyboard.getCommandCount(), keyboard.getMaxResponseMicros(), keyboard.getResendRequestCount(),
+                     keyboard.getResendLimitCount(), transferTimer.getString());
+}
@@ -0,0 +1,159 @@
+#ifndef BC6B7FB2_149F_4E2D_889A_197D0C98C741
+#define BC6B7FB2_149F_4E2D_889A_197D0C98C741
+
+#include <PS2Keyboard.hpp>
+#include <PS2Mouse.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+#include "byte_interval_tuner.hpp"
+#include "ps2_host_state.hpp"
+#include "ps2_port.hpp"
+#include "task_plan.hpp"
+extern "C" {
+#include <esp_timer.h>
+}
+
+// An esp32_ps2dev device which watches its replies to host commands.
+// Input is held back while a reply is in progress, so command responses never wait behind queued input. Resends (0xFE) of
+// the same byte are bounded; past the limit the device answers 0xFC (error) so the host gives up on the byte instead of
+// looping. Counts resend requests, i.e. bytes the host did not receive cleanly, and the worst-case response time.
+template <class Device>
+class MonitoredPs2Device : public Device {
+ public:
+  static constexpr std::uint32_t MAX_CONSECUTIVE_RESENDS = 3;
+
+ private:
+  std::atomic<bool> isReplying{false};
+  std::atomic<std::uint32_t> consecutiveResendCount{0};
+  std::atomic<std::uint32_t> commandCount{0};
+  std::atomic<std::uint32_t> resendRequestCount{0};
+  std::atomic<std::uint32_t> resendLimitCount{0};
+  std::atomic<std::int64_t> maxResponseMicros{0};
+
+ public:
+  using Device::Device;
+  int reply_to_host(uint8_t host_cmd) override {
+    isReplying.store(true);
+    const auto startMicros = esp_timer_get_time();
+    int ret;
+    if (host_cmd != 0xFE) {
+      consecutiveResendCount.store(0);
+      ret = Device::reply_to_host(host_cmd);
+    } else if (consecutiveResendCount.fetch_add(1) < MAX_CONSECUTIVE_RESENDS) {
+      resendRequestCount.fetch_add(1, std::memory_order_relaxed);
+      ret = Device::reply_to_host(host_cmd);
+    } else {
+      resendLimitCount.fetch_add(1, std::memory_order_relaxed);
+      ret = this->write(0xFC);
+    }
+    const auto responseMicros = esp_timer_get_time() - startMicros;
+    if (responseMicros > maxResponseMicros.load(std::memory_order_relaxed)) {
+      maxResponseMicros.store(responseMicros, std::memory_order_relaxed);
+    }
+    commandCount.fetch_add(1, std::memory_order_relaxed);
+    isReplying.store(false);
+    return ret;
+  }
+  bool isReplyingToHost() const { return isReplying.load(); }
+  // Called before new input is sent, which ends the resends of the previous bytes.
+  void clearResendSequence() { consecutiveResendCount.store(0); }
+  std::uint32_t getCommandCount() const { return commandCount.load(std::memory_order_relaxed); }
+  std::uint32_t getResendRequestCount() const { return resendRequestCount.load(std::memory_order_relaxed); }
+  std::uint32_t getResendLimitCount() const { return resendLimitCount.load(std::memory_order_relaxed); }
+  std::int64_t getMaxResponseMicros() const { return maxResponseMicros.load(std::memory_order_relaxed); }
+};
+
+using MonitoredPs2Mouse = MonitoredPs2Device<esp32_ps2dev::PS2Mouse>;
+using MonitoredPs2Keyboard = MonitoredPs2Device<esp32_ps2dev::PS2Keyboard>;
+
+// Adapts the byte interval of a device to the host's resend requests and interrupted transfers. update() runs on the task
+// which sends packets.
+class Ps2ByteIntervalControl {
+ private:
+  ByteIntervalTuner tuner;
+  std::uint32_t lastResendRequestCount = 0;
+  std::atomic<bool> isCalibrationRequested{false};
+  std::atomic<std::uint32_t> unsavedIntervalMicros{0};  // Learned interval not stored to NVS yet, 0 if none
+
+ public:
+  // Starts from the learned interval. If none has been learned yet, starts from the default, or calibrates if built with
+  // PS2BLE_PS2_BYTE_INTERVAL_AUTO_CALIBRATION.
+  void begin(esp32_ps2dev::PS2dev& device, std::uint32_t learnedIntervalMicros);
+  // Called after each packet with the device's resend request count, and whether the transfer was interrupted.
+  void update(esp32_ps2dev::PS2dev& device, std::uint32_t resendRequestCount, bool isInterrupted);
+  // Restarts calibration with the next packet. Thread safe.
+  void requestCalibration();
+  // Returns true and the learned interval if it changed since the last call. Thread safe.
+  bool takeUnsavedInterval(std::uint32_t& intervalMicros);
+};
+
+// Measures the time per byte of each packet, from the call into esp32_ps2dev until it returns. The PS/2 clock is generated
+// in software, so a task which preempts the transmission stretches the byte. Jitter is the spread between the fastest and
+// the slowest byte; it also includes waits for host inhibits and changes of the byte interval.
+class Ps2TransferTimer {
+ private:
+  std::atomic<std::int64_t> minByteMicros{std::numeric_limits<std::int64_t>::max()};
+  std::atomic<std::int64_t> maxByteMicros{0};
+
+ public:
+  // Called from the sending task only.
+  void addTransfer(std::int64_t elapsedMicros, std::size_t byteCount);
+  std::int64_t getJitterMicros() const;
+  std::string getString() const;
+};
+
+class Ps2devMousePort : public Ps2MousePort {
+ private:
+  MonitoredPs2Mouse& mouse;
+  Ps2ByteIntervalControl byteIntervalControl;
+  Ps2TransferTimer transferTimer;
+  Ps2HostState restoredHostState;
+  bool hasRestoredHostState = false;
+
+  bool isUsingRestoredHostState();
+  bool sendRestoredReport(const Ps2MousePacket& packet, bool& isInterrupted);
+
+ public:
+  explicit Ps2devMousePort(MonitoredPs2Mouse& mouse);
+  Ps2ByteIntervalControl& getByteIntervalControl();
+  // Uses the state until the host sends its first command: packets are sent in the restored format, or not at all if the
+  // host had disabled reporting. Call before input starts.
+  void restoreHostState(const Ps2HostState& state);
+  // Returns false while the host has not sent a command since boot, so there is nothing new to store.
+  bool captureHostState(Ps2HostState& state);
+  std::uint8_t getSampleRate() override;
+  bool hasWheel() override;
+  bool has4thAnd5thButtons() override;
+  bool isReadyToSend() override;
+  void sendReport(const Ps2MousePacket& packet) override;
+  std::string getCountersString() const;
+};
+
+// Sends scan codes from a queue on its own task. Each scan code is one frame which is sent without other input in between,
+// and frames wait while the keyboard replies to a host command.
+class Ps2devKeyboardPort : public Ps2KeyboardPort {
+ public:
+  static constexpr std::size_t FRAME_QUEUE_LENGTH = 32;
+
+ private:
+  MonitoredPs2Keyboard& keyboard;
+  Ps2ByteIntervalControl byteIntervalControl;
+  Ps2TransferTimer transferTimer;
+  QueueHandle_t frameQueue = nullptr;
+  std::atomic<std::uint32_t> maxQueueDepth{0};
+  std::atomic<std::uint32_t> droppedFrameCount{0};
+
+  static void transmitTask(void* arg);
+
+ public:
+  explicit Ps2devKeyboardPort(MonitoredPs2Keyboard& keyboard);
+  bool begin();
+  Ps2ByteIntervalControl& getByteIntervalControl();
+  void sendScanCode(const std::initializer_list<std::uint8_t>& scanCode) override;
+  std::string getCountersString() const;
+};
+
+#endif /* BC6B7FB2_149F_4E2D_889A_197D0C98C741 */
@@ -0,0 +1,56 @@
+#include "scan_scheduler.hpp"
+
+bool ScanParams::operator==(const ScanParams& other) const {
+  return isEnabled == other.isEnabled && intervalMillis == other.intervalMillis && windowMillis == other.windowMillis;
+}
+
+bool ScanParams::operator!=(const ScanParams& other) const { return !(*this == other); }
+
+// 50% duty cycle for 10 s, 15% until 1 min, then about 2%.
+const ScanScheduler::Step ScanScheduler::STEPS[STEP_COUNT] = {
+    {10000000, 40, 20},
+    {60000000, 100, 15},
+    {-1, 640, 12},
+};
+
+void ScanScheduler::reset(std::int64_t nowMicros) { resetMicros = nowMicros; }
+
+// Devices which are already connected are served first, so the first step is skipped while any link is up.
+int ScanScheduler::getStepIndex(int connectedBondedCount, std::int64_t nowMicros) const {
+  auto elapsedMicros = nowMicros - resetMicros;
+  auto index = 0;
+  while (index < STEP_COUNT - 1 && elapsedMicros >= STEPS[index].untilMicros) {
+    index++;
+  }
+  if (connectedBondedCount > 0 && index == 0) {
+    index = 1;
+  }
+  return index;
+}
+
+ScanParams ScanScheduler::getParams(bool isPairing, int bondedCount, int connectedBondedCount, std::int64_t nowMicros) const {
+  ScanParams params;
+  if (isPairing) {
+    params.isEnabled = true;
+    params.intervalMillis = STEPS[0].intervalMillis;
+    params.windowMillis = STEPS[0].windowMillis;
+    return params;
+  }
+  if (bondedCount == 0 || connectedBondedCount >= bondedCount) {
+    return params;
+  }
+  const auto& step = STEPS[getStepIndex(connectedBondedCount, nowMicros)];
+  params.isEnabled = true;
+  params.intervalMillis = step.intervalMillis;
+  params.windowMillis = step.windowMillis;
+  return params;
+}
+
+std::int64_t ScanScheduler::getNextChangeMicros(bool isPairing, int bondedCount, int connectedBondedCount,
+                                                std::int64_t nowMicros) const {
+  if (isPairing || bondedCount == 0 || connectedBondedCount >= bondedCount) {
+    return -1;
+  }
+  const auto& step = STEPS[getStepIndex(connectedBondedCount, nowMicros)];
+  return step.untilMicros < 0 ? -1 : resetMicros + step.untilMicros;
+}
@@ -0,0 +1,43 @@
+#ifndef D899A1A3_9130_4FE2_95E0_309B0CBFFE65
+#define D899A1A3_9130_4FE2_95E0_309B0CBFFE65
+
+#include <cstdint>
+
+class ScanParams {
+ public:
+  bool isEnabled = false;
+  std::uint16_t intervalMillis = 0;
+  std::uint16_t windowMillis = 0;
+
+  bool operator==(const ScanParams& other) const;
+  bool operator!=(const ScanParams& other) const;
+};
+
+// Chooses the scan duty cycle. Scanning takes radio time from the HID links, so it is aggressive only right after boot
+// or a disconnect, when a device is most likely to come back, and backs off from there and as devices connect. It stops
+// once every bonded device is connected. While pairing, the user is waiting, so it always scans aggressively.
+// Pure logic, driven by the caller's clock.
+class ScanScheduler {
+ public:
+  class Step {
+   public:
+    std::int64_t untilMicros;  // Since the last reset, or -1 for the last step
+    std::uint16_t intervalMillis;
+    std::uint16_t windowMillis;
+  };
+  static constexpr int STEP_COUNT = 3;
+  static const Step STEPS[STEP_COUNT];
+
+ private:
+  std::int64_t resetMicros = 0;
+  int getStepIndex(int connectedBondedCount, std::int64_t nowMicros) const;
+
+ public:
+  // Restarts the back-off, called at boot and when a bonded device disconnects.
+  void reset(std::int64_t nowMicros);
+  ScanParams getParams(bool isPairing, int bondedCount, int connectedBondedCount, std::int64_t nowMicros) const;
+  // Time at which getParams changes without any other event, or -1 if it does not.
+  std::int64_t getNextChangeMicros(bool isPairing, int bondedCount, int connectedBondedCount, std::int64_t nowMicros) const;
+};
+
+#endif /* D899A1A3_9130_4FE2_95E0_309B0CBFFE65 */
@@ -0,0 +1,29 @@
+#ifndef F2881B4F_6648_4F91_A7AC_16975EC44ABD
+#define F2881B4F_6648_4F91_A7AC_16975EC44ABD
+
+#include <Arduino.h>
+
+// Cores and priorities of the tasks. The PS/2 clock is generated in software, so everything which drives the PS/2 lines
+// runs on its own core at the highest priority of our tasks. The NimBLE host runs on the other core
+// (CONFIG_BT_NIMBLE_PINNED_TO_CORE), and so do BLE scanning, connecting and report decoding, which happens in its notify
+// callbacks. The async web server is pinned to the BLE core by CONFIG_ASYNC_TCP_RUNNING_CORE in platformio.ini and runs at
+// AsyncTCP's fixed priority 3, so the BLE tasks run above it. The serial logger runs on the BLE core at priority 0 (see
+// logging.hpp). Each value can be overridden with a build flag.
+
+#ifndef PS2BLE_PS2_TASK_CORE
+#define PS2BLE_PS2_TASK_CORE APP_CPU_NUM
+#endif
+
+#ifndef PS2BLE_PS2_TASK_PRIORITY
+#define PS2BLE_PS2_TASK_PRIORITY 10
+#endif
+
+#ifndef PS2BLE_BLE_TASK_CORE
+#define PS2BLE_BLE_TASK_CORE PRO_CPU_NUM
+#endif
+
+#ifndef PS2BLE_BLE_TASK_PRIORITY
+#define PS2BLE_BLE_TASK_PRIORITY 4
+#endif
+
+#endif /* F2881B4F_6648_4F91_A7AC_16975EC44ABD */
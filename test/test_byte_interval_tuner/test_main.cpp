@@ -0,0 +1,149 @@
+#include <unity.h>
+
+#include <cstdint>
+
+#include "byte_interval_tuner.hpp"
+
+// A host which rejects every byte sent with a shorter interval than its limit.
+static bool isRejected(const ByteIntervalTuner& tuner, std::uint32_t hostLimitMicros) {
+  return tuner.getIntervalMicros() < hostLimitMicros;
+}
+
+// Sends packets to the host until calibration ends or packetCount is reached, and returns the number of learned changes.
+static int runCalibration(ByteIntervalTuner& tuner, std::uint32_t hostLimitMicros, int packetCount) {
+  auto learnedChangeCount = 0;
+  for (int i = 0; i < packetCount && tuner.isCalibrationRunning(); i++) {
+    auto isChanged = isRejected(tuner, hostLimitMicros) ? tuner.onTransmissionError(Ps2TransmissionError::Resend) : tuner.onPacketSent();
+    learnedChangeCount += isChanged;
+  }
+  return learnedChangeCount;
+}
+
+static void sendCleanPackets(ByteIntervalTuner& tuner, std::uint32_t count) {
+  for (std::uint32_t i = 0; i < count; i++) {
+    tuner.onPacketSent();
+  }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_invalid_stored_interval_starts_from_default() {
+  ByteIntervalTuner tuner(0);
+
+  TEST_ASSERT_FALSE(tuner.isCalibrationRunning());
+  TEST_ASSERT_EQUAL_UINT32(ByteIntervalTuner::DEFAULT_INTERVAL_MICROS, tuner.getIntervalMicros());
+  TEST_ASSERT_EQUAL_UINT32(ByteIntervalTuner::DEFAULT_INTERVAL_MICROS, tuner.getLearnedIntervalMicros());
+}
+
+// Without calibration, clean packets never shorten the interval.
+void test_clean_packets_keep_learned_interval() {
+  ByteIntervalTuner tuner(60);
+  sendCleanPackets(tuner, ByteIntervalTuner::CLEAN_PACKETS_PER_STEP * 20);
+
+  TEST_ASSERT_EQUAL_UINT32(60, tuner.getIntervalMicros());
+}
+
+void test_calibration_settles_one_step_above_host_limit() {
+  ByteIntervalTuner tuner(60);
+  tuner.startCalibration();
+  auto learnedChangeCount = runCalibration(tuner, 32, 100000);
+
+  TEST_ASSERT_FALSE(tuner.isCalibrationRunning());
+  TEST_ASSERT_EQUAL_INT(1, learnedChangeCount);
+  TEST_ASSERT_EQUAL_UINT32(35, tuner.getLearnedIntervalMicros());
+  TEST_ASSERT_EQUAL_UINT32(35, tuner.getIntervalMicros());
+}
+
+void test_calibration_stops_at_minimum() {
+  ByteIntervalTuner tuner(60);
+  tuner.startCalibration();
+  runCalibration(tuner, 0, 100000);
+
+  TEST_ASSERT_FALSE(tuner.isCalibrationRunning());
+  TEST_ASSERT_EQUAL_UINT32(ByteIntervalTuner::MIN_INTERVAL_MICROS, tuner.getLearnedIntervalMicros());
+}
+
+// An interrupted transfer during calibration means the interval is too short, like a resend.
+void test_interrupt_during_calibration_raises_floor() {
+  ByteIntervalTuner tuner(60);
+  tuner.startCalibration();
+  for (int i = 0; i < 100000 && tuner.isCalibrationRunning(); i++) {
+    if (tuner.getIntervalMicros() < 50) {
+      tuner.onTransmissionError(Ps2TransmissionError::Interrupted);
+    } else {
+      tuner.onPacketSent();
+    }
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(50, tuner.getLearnedIntervalMicros());
+}
+
+void test_errors_back_off_and_recover() {
+  ByteIntervalTuner tuner(60);
+  tuner.onTransmissionError(Ps2TransmissionError::Resend);
+
+  TEST_ASSERT_EQUAL_UINT32(120, tuner.getIntervalMicros());
+  TEST_ASSERT_EQUAL_UINT32(60, tuner.getLearnedIntervalMicros());
+  sendCleanPackets(tuner, ByteIntervalTuner::CLEAN_PACKETS_PER_STEP * 12);
+  TEST_ASSERT_EQUAL_UINT32(60, tuner.getIntervalMicros());
+}
+
+// Each resend comes right after the back-off has recovered to the learned interval.
+void test_persisting_resends_raise_learned_interval() {
+  ByteIntervalTuner tuner(60);
+  auto isChanged = false;
+  for (std::uint32_t i = 0; i < ByteIntervalTuner::ERRORS_TO_RAISE_LEARNED; i++) {
+    isChanged = tuner.onTransmissionError(Ps2TransmissionError::Resend);
+    sendCleanPackets(tuner, ByteIntervalTuner::CLEAN_PACKETS_PER_STEP * 12);
+  }
+
+  TEST_ASSERT_TRUE(isChanged);
+  TEST_ASSERT_EQUAL_UINT32(60 + ByteIntervalTuner::STEP_MICROS, tuner.getLearnedIntervalMicros());
+}
+
+// Hosts inhibit the clock while they are busy, so interrupts alone never raise the stored interval.
+void test_persisting_interrupts_keep_learned_interval() {
+  ByteIntervalTuner tuner(60);
+  for (int i = 0; i < 100; i++) {
+    TEST_ASSERT_FALSE(tuner.onTransmissionError(Ps2TransmissionError::Interrupted));
+    sendCleanPackets(tuner, ByteIntervalTuner::CLEAN_PACKETS_PER_STEP * 12);
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(60, tuner.getLearnedIntervalMicros());
+  TEST_ASSERT_EQUAL_UINT32(60, tuner.getIntervalMicros());
+}
+
+void test_back_off_is_bounded() {
+  ByteIntervalTuner tuner(60);
+  for (int i = 0; i < 20; i++) {
+    tuner.onTransmissionError(Ps2TransmissionError::Interrupted);
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(ByteIntervalTuner::MAX_INTERVAL_MICROS, tuner.getIntervalMicros());
+}
+
+void test_transfer_interrupted_by_time() {
+  // 4 bytes at a 12.5 kHz clock take 4 * (880 + 60) us.
+  TEST_ASSERT_FALSE(isTransferInterrupted(4 * (880 + 60), 4, 60));
+  // At the slowest clock of 10 kHz.
+  TEST_ASSERT_FALSE(isTransferInterrupted(4 * (1100 + 60), 4, 60));
+  // A 2 ms inhibit and a byte sent again.
+  TEST_ASSERT_TRUE(isTransferInterrupted(4 * (880 + 60) + 2000 + 880, 4, 60));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_invalid_stored_interval_starts_from_default);
+  RUN_TEST(test_clean_packets_keep_learned_interval);
+  RUN_TEST(test_calibration_settles_one_step_above_host_limit);
+  RUN_TEST(test_calibration_stops_at_minimum);
+  RUN_TEST(test_interrupt_during_calibration_raises_floor);
+  RUN_TEST(test_errors_back_off_and_recover);
+  RUN_TEST(test_persisting_resends_raise_learned_interval);
+  RUN_TEST(test_persisting_interrupts_keep_learned_interval);
+  RUN_TEST(test_back_off_is_bounded);
+  RUN_TEST(test_transfer_interrupted_by_time);
+  return UNITY_END();
+}
@@ -0,0 +1,205 @@
+#include <fmt/core.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "link_phase.hpp"
+
+// Same guard as the PS/2 mouse sender: time after a connection event for the notify callback to run.
+static constexpr std::int64_t GUARD_MICROS = 300;
+static constexpr std::int64_t JITTER_MICROS = 400;  // Scheduling delay of the notify callback on the host
+static constexpr std::int64_t DURATION_MICROS = 10000000;
+static constexpr std::int64_t SETTLE_MICROS = 1000000;  // Not measured while the estimator locks
+
+class Distribution {
+ public:
+  std::int64_t min = 0;
+  std::int64_t mean = 0;
+  std::int64_t p99 = 0;
+  std::int64_t max = 0;
+
+  explicit Distribution(const std::vector<std::int64_t>& samples) {
+    if (samples.empty()) {
+      return;
+    }
+    auto values = samples;
+    std::sort(values.begin(), values.end());
+    min = values.front();
+    max = values.back();
+    p99 = values[values.size() * 99 / 100];
+    std::int64_t sum = 0;
+    for (auto value : values) {
+      sum += value;
+    }
+    mean = sum / static_cast<std::int64_t>(values.size());
+  }
+  std::string toString() const { return fmt::format("min {} mean {} p99 {} max {}", min, mean, p99, max); }
+};
+
+class SenderResult {
+ public:
+  std::vector<std::int64_t> latencyMicros;  // Per notification, until the packet which carries its input is sent
+  std::vector<std::int64_t> gapMicros;      // Between consecutive packets, the inter-packet jitter is their spread
+};
+
+// Arrival times of notifications on a link with the given connection interval, first event at offsetMicros.
+// Every arrival is delayed by up to JITTER_MICROS, and one event in skipEvery carries no notification.
+static std::vector<std::int64_t> makeArrivals(std::int64_t intervalMicros, std::int64_t offsetMicros, int skipEvery) {
+  std::mt19937 random(12345);
+  std::vector<std::int64_t> arrivals;
+  int event = 0;
+  for (auto eventMicros = offsetMicros; eventMicros < DURATION_MICROS; eventMicros += intervalMicros) {
+    if (skipEvery != 0 && ++event % skipEvery == 0) {
+      continue;
+    }
+    arrivals.push_back(eventMicros + static_cast<std::int64_t>(random() % JITTER_MICROS));
+  }
+  return arrivals;
+}
+
+// Runs the timing of Ps2MouseSender against the arrivals: each arrival requests a flush at the next packet time, which is
+// checked again when the flush runs, and the packet then carries all input which arrived so far.
+static SenderResult simulateSender(const std::vector<std::int64_t>& arrivals, std::int64_t packetIntervalMicros, bool isAligned) {
+  LinkPhaseEstimator estimator;
+  std::int64_t anchorMicros = 0;
+  std::int64_t linkIntervalMicros = 0;
+  auto getNextPacketTimeMicros = [&](std::int64_t lastPacketMicros) {
+    auto nominalMicros = lastPacketMicros + packetIntervalMicros;
+    return isAligned ? alignToLinkPhase(nominalMicros, packetIntervalMicros, anchorMicros, linkIntervalMicros, GUARD_MICROS)
+                     : nominalMicros;
+  };
+
+  SenderResult result;
+  std::vector<std::int64_t> pending;
+  std::int64_t lastPacketMicros = -packetIntervalMicros;
+  std::int64_t flushMicros = -1;  // Time of the armed flush timer, -1 if none
+  std::size_t nextArrival = 0;
+  while (nextArrival < arrivals.size() || flushMicros >= 0) {
+    if (nextArrival < arrivals.size() && (flushMicros < 0 || arrivals[nextArrival] <= flushMicros)) {
+      auto arrivalMicros = arrivals[nextArrival++];
+      estimator.addArrival(arrivalMicros);
+      if (estimator.isLocked()) {
+        anchorMicros = estimator.getAnchorMicros();
+        linkIntervalMicros = estimator.getIntervalMicros();
+      }
+      pending.push_back(arrivalMicros);
+      if (flushMicros < 0) {
+        flushMicros = std::max(arrivalMicros, getNextPacketTimeMicros(lastPacketMicros));
+      }
+      continue;
+    }
+    auto nowMicros = flushMicros;
+    auto nextPacketMicros = getNextPacketTimeMicros(lastPacketMicros);
+    if (nowMicros < nextPacketMicros) {
+      flushMicros = nextPacketMicros;
+      continue;
+    }
+    flushMicros = -1;
+    if (nowMicros >= SETTLE_MICROS) {
+      for (auto arrivalMicros : pending) {
+        result.latencyMicros.push_back(nowMicros - arrivalMicros);
+      }
+      result.gapMicros.push_back(nowMicros - lastPacketMicros);
+    }
+    pending.clear();
+    lastPacketMicros = nowMicros;
+  }
+  return result;
+}
+
+static void reportResults(const char* name, const SenderResult& unaligned, const SenderResult& aligned) {
+  TEST_MESSAGE(fmt::format("{} latency us: {} -> {}", name, Distribution(unaligned.latencyMicros).toString(),
+                           Distribution(aligned.latencyMicros).toString())
+                   .c_str());
+  TEST_MESSAGE(fmt::format("{} packet gap us: {} -> {}", name, Distribution(unaligned.gapMicros).toString(),
+                           Distribution(aligned.gapMicros).toString())
+                   .c_str());
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_estimator_locks_despite_jitter_and_skipped_events() {
+  LinkPhaseEstimator estimator;
+  for (auto arrivalMicros : makeArrivals(7500, 1234, 7)) {
+    estimator.addArrival(arrivalMicros);
+  }
+
+  TEST_ASSERT_TRUE(estimator.isLocked());
+  TEST_ASSERT_INT64_WITHIN(100, 7500, estimator.getIntervalMicros());
+  // The anchor lies on the event grid, late by about the mean jitter.
+  auto phaseMicros = (estimator.getAnchorMicros() - 1234) % 7500;
+  TEST_ASSERT_INT64_WITHIN(JITTER_MICROS, JITTER_MICROS / 2, phaseMicros);
+}
+
+void test_estimator_relearns_interval_after_parameter_update() {
+  LinkPhaseEstimator estimator;
+  for (auto arrivalMicros : makeArrivals(7500, 0, 0)) {
+    if (arrivalMicros < DURATION_MICROS / 2) {
+      estimator.addArrival(arrivalMicros);
+    }
+  }
+  for (auto arrivalMicros : makeArrivals(15000, 3000, 0)) {
+    if (arrivalMicros >= DURATION_MICROS / 2) {
+      estimator.addArrival(arrivalMicros);
+    }
+  }
+
+  TEST_ASSERT_INT64_WITHIN(200, 15000, estimator.getIntervalMicros());
+}
+
+// Packets may only be delayed, by at most a quarter of the packet interval, so the host's sample rate is kept.
+void test_alignment_only_delays_packets() {
+  for (std::int64_t nominalMicros = 100000; nominalMicros < 200000; nominalMicros += 137) {
+    auto alignedMicros = alignToLinkPhase(nominalMicros, 10000, 1234, 7500, GUARD_MICROS);
+    TEST_ASSERT_GREATER_OR_EQUAL(nominalMicros, alignedMicros);
+    TEST_ASSERT_LESS_OR_EQUAL(nominalMicros + 10000 / 4, alignedMicros);
+  }
+  TEST_ASSERT_EQUAL_INT64(5000, alignToLinkPhase(5000, 10000, 0, 7500, GUARD_MICROS));
+  TEST_ASSERT_EQUAL_INT64(5000, alignToLinkPhase(5000, 10000, 1234, 15000, GUARD_MICROS));
+}
+
+// Host sample rate of 100 packets/s on a 7.5 ms link.
+void test_alignment_on_fast_link() {
+  auto arrivals = makeArrivals(7500, 1234, 0);
+  auto unaligned = simulateSender(arrivals, 10000, false);
+  auto aligned = simulateSender(arrivals, 10000, true);
+  reportResults("BLE 7.5 ms, PS/2 10 ms", unaligned, aligned);
+  Distribution unalignedLatency(unaligned.latencyMicros);
+  Distribution alignedLatency(aligned.latencyMicros);
+  Distribution alignedGap(aligned.gapMicros);
+
+  // The sample rate is kept. Alignment trades inter-packet jitter, up to a quarter of the interval, for latency.
+  TEST_ASSERT_GREATER_OR_EQUAL(10000, Distribution(unaligned.gapMicros).min);
+  TEST_ASSERT_GREATER_OR_EQUAL(10000, alignedGap.min);
+  TEST_ASSERT_LESS_OR_EQUAL(10000 + 10000 / 4, alignedGap.max);
+  TEST_ASSERT_LESS_OR_EQUAL(unalignedLatency.mean, alignedLatency.mean);
+  TEST_ASSERT_LESS_OR_EQUAL(unalignedLatency.p99, alignedLatency.p99);
+  TEST_ASSERT_LESS_OR_EQUAL(unalignedLatency.max, alignedLatency.max);
+}
+
+// Host sample rate of 100 packets/s on a 15 ms link with skipped events: input arrives less often than packets may be sent,
+// so the sender does not align and its timing is unchanged.
+void test_no_alignment_on_slow_link() {
+  auto arrivals = makeArrivals(15000, 4321, 5);
+  auto unaligned = simulateSender(arrivals, 10000, false);
+  auto aligned = simulateSender(arrivals, 10000, true);
+  reportResults("BLE 15 ms, PS/2 10 ms", unaligned, aligned);
+
+  TEST_ASSERT_TRUE(unaligned.latencyMicros == aligned.latencyMicros);
+  TEST_ASSERT_TRUE(unaligned.gapMicros == aligned.gapMicros);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_estimator_locks_despite_jitter_and_skipped_events);
+  RUN_TEST(test_estimator_relearns_interval_after_parameter_update);
+  RUN_TEST(test_alignment_only_delays_packets);
+  RUN_TEST(test_alignment_on_fast_link);
+  RUN_TEST(test_no_alignment_on_slow_link);
+  return UNITY_END();
+}
@@ -0,0 +1,115 @@
+#include <unity.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "mouse_accumulator.hpp"
+
+// Replays a BLE mouse reporting every 7.5 ms (the shortest connection interval) into a PS/2 host polling at 200 packets/s.
+static constexpr std::int64_t BLE_REPORT_INTERVAL_MICROS = 7500;
+static constexpr std::int64_t PS2_PACKET_INTERVAL_MICROS = 5000;
+// A 16000 DPI mouse is at 120 counts per 7.5 ms report at 1 inch/s.
+static constexpr std::int32_t COUNTS_PER_INCH_PER_SECOND = 120;
+
+class ReplayResult {
+ public:
+  std::vector<Ps2MousePacket> packets;
+  std::int64_t sentX = 0;
+  std::int64_t sentY = 0;
+  std::size_t lastMovingPacket = 0;  // Index after the last packet with motion
+};
+
+// Sends reportCount reports of (x, y), then keeps polling for idlePacketCount packets.
+static ReplayResult replay(MouseAccumulator& accumulator, std::int32_t x, std::int32_t y, std::size_t reportCount,
+                           std::size_t idlePacketCount) {
+  ReplayResult result;
+  std::int64_t nextReportMicros = 0;
+  std::size_t sentReportCount = 0;
+  std::size_t idlePackets = 0;
+  for (std::int64_t now = 0; idlePackets < idlePacketCount; now += PS2_PACKET_INTERVAL_MICROS) {
+    while (sentReportCount < reportCount && nextReportMicros <= now) {
+      accumulator.addMotion(x, y, 0, 0);
+      sentReportCount++;
+      nextReportMicros += BLE_REPORT_INTERVAL_MICROS;
+    }
+    if (sentReportCount == reportCount) {
+      idlePackets++;
+    }
+    if (!accumulator.hasPending()) {
+      continue;
+    }
+    auto packet = accumulator.takePacket(Ps2MouseType::IntelliMouse);
+    result.packets.push_back(packet);
+    result.sentX += packet.x;
+    result.sentY += packet.y;
+    if (packet.x != 0 || packet.y != 0) {
+      result.lastMovingPacket = result.packets.size();
+    }
+  }
+  return result;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// 2 inches/s at 16000 DPI is 240 counts per report, 160 per PS/2 packet: within capacity, nothing may be lost.
+void test_high_dpi_within_capacity() {
+  MouseAccumulator accumulator;
+  auto x = 2 * COUNTS_PER_INCH_PER_SECOND;
+  auto result = replay(accumulator, x, -x / 2, 400, 20);
+
+  TEST_ASSERT_EQUAL_INT64(400 * x, result.sentX);
+  TEST_ASSERT_EQUAL_INT64(400 * x / 2, result.sentY);
+  TEST_ASSERT_EQUAL_UINT32(0, accumulator.getCounters().droppedCount);
+  TEST_ASSERT_FALSE(accumulator.hasPending());
+}
+
+// A 5 inches/s flick is 600 counts per report, 400 per PS/2 packet: more than 255 a packet can carry.
+void test_high_dpi_flick_stops_with_hand() {
+  MouseAccumulator accumulator;
+  std::int32_t x = 5 * COUNTS_PER_INCH_PER_SECOND;
+  std::size_t reportCount = 40;
+  auto result = replay(accumulator, x, 0, reportCount, 40);
+  const auto& counters = accumulator.getCounters();
+
+  TEST_ASSERT_GREATER_OR_EQUAL(1, counters.saturatedPacketCount);
+  TEST_ASSERT_GREATER_OR_EQUAL(1, counters.droppedCount);
+  TEST_ASSERT_EQUAL_INT64(static_cast<std::int64_t>(reportCount) * x, result.sentX + counters.droppedCount);
+  // The last report arrives with packet reportCount * 1.5; the carry is drained within MAX_CARRY_PACKETS more.
+  auto lastReportPacket = (reportCount - 1) * BLE_REPORT_INTERVAL_MICROS / PS2_PACKET_INTERVAL_MICROS + 1;
+  TEST_ASSERT_LESS_OR_EQUAL(lastReportPacket + MouseAccumulator::MAX_CARRY_PACKETS + 1, result.lastMovingPacket);
+}
+
+void test_packets_stay_in_range() {
+  MouseAccumulator accumulator;
+  auto result = replay(accumulator, 30000, -30000, 20, 20);
+
+  for (const auto& packet : result.packets) {
+    TEST_ASSERT_LESS_OR_EQUAL(MouseAccumulator::PS2_MOTION_MAX, packet.x);
+    TEST_ASSERT_GREATER_OR_EQUAL(MouseAccumulator::PS2_MOTION_MIN, packet.x);
+    TEST_ASSERT_LESS_OR_EQUAL(MouseAccumulator::PS2_MOTION_MAX, packet.y);
+    TEST_ASSERT_GREATER_OR_EQUAL(MouseAccumulator::PS2_MOTION_MIN, packet.y);
+  }
+}
+
+// HID Y points down and PS/2 Y points up.
+void test_y_is_inverted() {
+  MouseAccumulator accumulator;
+  accumulator.addMotion(3, 10, 0, 0);
+  auto packet = accumulator.takePacket(Ps2MouseType::Generic);
+
+  TEST_ASSERT_EQUAL_INT16(3, packet.x);
+  TEST_ASSERT_EQUAL_INT16(-10, packet.y);
+  TEST_ASSERT_FALSE(packet.isSaturated);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_high_dpi_within_capacity);
+  RUN_TEST(test_high_dpi_flick_stops_with_hand);
+  RUN_TEST(test_packets_stay_in_range);
+  RUN_TEST(test_y_is_inverted);
+  return UNITY_END();
+}
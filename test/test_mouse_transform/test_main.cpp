@@ -0,0 +1,109 @@
+#include <fmt/core.h>
+#include <unity.h>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "mouse_transform.hpp"
+
+static MotionTransformConfig makeConfig(std::uint32_t scalePercent, bool isAccelerationEnabled) {
+  MotionTransformConfig config;
+  config.scale = percentToFixed16(scalePercent);
+  config.isAccelerationEnabled = isAccelerationEnabled;
+  return config;
+}
+
+static MouseReport makeReport(std::int32_t x, std::int32_t y) {
+  MouseReport report;
+  report.x = x;
+  report.y = y;
+  return report;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_identity_leaves_motion_unchanged() {
+  MotionTransform transform(makeConfig(100, false));
+  auto report = makeReport(-1234, 567);
+  transform.apply(report);
+
+  TEST_ASSERT_TRUE(transform.isIdentity());
+  TEST_ASSERT_EQUAL_INT(-1234, report.x);
+  TEST_ASSERT_EQUAL_INT(567, report.y);
+}
+
+// At 25% a one count movement is only sent every fourth report, but none of it is lost.
+void test_slow_motion_is_not_quantized_away() {
+  MotionTransform transform(makeConfig(25, false));
+  std::int32_t sumX = 0;
+  std::int32_t sumY = 0;
+  for (int i = 0; i < 400; i++) {
+    auto report = makeReport(1, -1);
+    transform.apply(report);
+    sumX += report.x;
+    sumY += report.y;
+  }
+
+  TEST_ASSERT_INT_WITHIN(1, 100, sumX);
+  TEST_ASSERT_INT_WITHIN(1, -100, sumY);
+}
+
+void test_acceleration_follows_table() {
+  auto config = makeConfig(100, true);
+  MotionTransform transform(config);
+  auto slow = makeReport(1, 0);
+  transform.apply(slow);
+  transform.reset();
+  auto fast = makeReport(100, 0);
+  transform.apply(fast);
+
+  TEST_ASSERT_EQUAL_INT(1, slow.x);
+  TEST_ASSERT_EQUAL_INT(100 * config.accelerationTable.back() / GAIN8_ONE, fast.x);
+}
+
+void test_set_config_resets_remainder() {
+  MotionTransform transform(makeConfig(50, false));
+  auto report = makeReport(1, 0);
+  transform.apply(report);
+  transform.setConfig(makeConfig(50, false));
+  report = makeReport(1, 0);
+  transform.apply(report);
+
+  TEST_ASSERT_EQUAL_INT(0, report.x);
+}
+
+// Runs the per-report path on a replay of a 16000 DPI mouse, so its cost can be compared with the 7.5 ms report interval.
+void test_benchmark_apply() {
+  constexpr int REPORT_COUNT = 1000000;
+  std::vector<MouseReport> reports;
+  for (int i = 0; i < 1000; i++) {
+    reports.push_back(makeReport((i % 61) - 30, (i % 37) * 3 - 54));
+  }
+  MotionTransform transform(makeConfig(40, true));
+  std::int64_t checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < REPORT_COUNT; i++) {
+    auto report = reports[i % reports.size()];
+    transform.apply(report);
+    checksum += report.x + report.y;
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  auto nanosPerReport = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / REPORT_COUNT;
+  TEST_MESSAGE(fmt::format("MotionTransform::apply: {} ns per report (checksum {})", nanosPerReport, checksum).c_str());
+
+  // Loose enough for a slow CI host; a regression to floating point or division per report still shows in the message.
+  TEST_ASSERT_LESS_OR_EQUAL(1000, nanosPerReport);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_identity_leaves_motion_unchanged);
+  RUN_TEST(test_slow_motion_is_not_quantized_away);
+  RUN_TEST(test_acceleration_follows_table);
+  RUN_TEST(test_set_config_resets_remainder);
+  RUN_TEST(test_benchmark_apply);
+  return UNITY_END();
+}
@@ -0,0 +1,103 @@
+#include <unity.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hid/report_map.hpp"
+
+// A mouse with a 12-bit X/Y, a wheel and AC Pan (report 1) and a boot-like keyboard with LEDs (report 2).
+// It has 1- and 2-byte item values and usage ranges, so chunk boundaries fall inside items.
+static const std::vector<std::uint8_t> RAW_REPORT_MAP = {
+    0x05, 0x01, 0x09, 0x02, 0xA1, 0x01, 0x85, 0x01, 0x09, 0x01, 0xA1, 0x00, 0x05, 0x09, 0x19, 0x01, 0x29, 0x05, 0x15,
+    0x00, 0x25, 0x01, 0x95, 0x05, 0x75, 0x01, 0x81, 0x02, 0x95, 0x01, 0x75, 0x03, 0x81, 0x01, 0x05, 0x01, 0x09, 0x30,
+    0x09, 0x31, 0x16, 0x01, 0xF8, 0x26, 0xFF, 0x07, 0x75, 0x0C, 0x95, 0x02, 0x81, 0x06, 0x09, 0x38, 0x15, 0x81, 0x25,
+    0x7F, 0x75, 0x08, 0x95, 0x01, 0x81, 0x06, 0x05, 0x0C, 0x0A, 0x38, 0x02, 0x95, 0x01, 0x81, 0x06, 0xC0, 0xC0, 0x05,
+    0x01, 0x09, 0x06, 0xA1, 0x01, 0x85, 0x02, 0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01,
+    0x95, 0x08, 0x81, 0x02, 0x95, 0x01, 0x75, 0x08, 0x81, 0x01, 0x95, 0x05, 0x75, 0x01, 0x05, 0x08, 0x19, 0x01, 0x29,
+    0x05, 0x91, 0x02, 0x95, 0x01, 0x75, 0x03, 0x91, 0x01, 0x95, 0x06, 0x75, 0x08, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x05,
+    0x07, 0x19, 0x00, 0x2A, 0xFF, 0x00, 0x81, 0x00, 0xC0,
+};
+
+static void assertEqualItemLists(const std::unordered_map<reportID_t, const ReportItemList*>& expected,
+                                 const std::unordered_map<reportID_t, const ReportItemList*>& actual) {
+  TEST_ASSERT_EQUAL(expected.size(), actual.size());
+  for (const auto& itemList : expected) {
+    auto it = actual.find(itemList.first);
+    TEST_ASSERT_TRUE(it != actual.end());
+    TEST_ASSERT_EQUAL_STRING(itemList.second->toString().c_str(), it->second->toString().c_str());
+  }
+}
+
+static void assertEqualReportMaps(const ReportMap& expected, const ReportMap& actual) {
+  assertEqualItemLists(expected.getInputReportItemLists(), actual.getInputReportItemLists());
+  assertEqualItemLists(expected.getOutputReportItemLists(), actual.getOutputReportItemLists());
+  assertEqualItemLists(expected.getFeatureReportItemLists(), actual.getFeatureReportItemLists());
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_whole_buffer_finds_all_reports() {
+  ReportMap reportMap(RAW_REPORT_MAP.data(), RAW_REPORT_MAP.size());
+  // Each application collection gets an input, an output and a feature list
+  TEST_ASSERT_EQUAL(2, reportMap.getInputReportItemLists().size());
+  TEST_ASSERT_EQUAL(2, reportMap.getOutputReportItemLists().size());
+  TEST_ASSERT_EQUAL(5, reportMap.getInputReportItemList(1)->getItems().size());
+  TEST_ASSERT_EQUAL(3, reportMap.getInputReportItemList(2)->getItems().size());
+  TEST_ASSERT_EQUAL(0, reportMap.getOutputReportItemList(1)->getItems().size());
+  TEST_ASSERT_EQUAL(2, reportMap.getOutputReportItemList(2)->getItems().size());
+}
+
+// Every chunk size from one byte (an ATT MTU of 23 with tiny reads) to the whole map must give the same result.
+void test_fixed_chunks_equal_whole_buffer() {
+  ReportMap expected(RAW_REPORT_MAP.data(), RAW_REPORT_MAP.size());
+  for (std::size_t chunkSize = 1; chunkSize <= RAW_REPORT_MAP.size(); chunkSize++) {
+    ReportMap actual;
+    ReportMapParser parser(actual);
+    for (std::size_t offset = 0; offset < RAW_REPORT_MAP.size(); offset += chunkSize) {
+      auto length = std::min(chunkSize, RAW_REPORT_MAP.size() - offset);
+      parser.feed(RAW_REPORT_MAP.data() + offset, length);
+    }
+    TEST_ASSERT_TRUE(parser.isAtItemBoundary());
+    assertEqualReportMaps(expected, actual);
+  }
+}
+
+// Splits at every pair of positions, so each item is cut at each of its bytes.
+void test_uneven_chunks_equal_whole_buffer() {
+  ReportMap expected(RAW_REPORT_MAP.data(), RAW_REPORT_MAP.size());
+  const auto size = RAW_REPORT_MAP.size();
+  for (std::size_t first = 0; first <= size; first++) {
+    for (std::size_t second = first; second <= size; second += 7) {
+      ReportMap actual;
+      ReportMapParser parser(actual);
+      parser.feed(RAW_REPORT_MAP.data(), first);
+      parser.feed(RAW_REPORT_MAP.data() + first, second - first);
+      parser.feed(RAW_REPORT_MAP.data() + second, size - second);
+      assertEqualReportMaps(expected, actual);
+    }
+  }
+}
+
+void test_item_boundary_within_item() {
+  ReportMap reportMap;
+  ReportMapParser parser(reportMap);
+  // Logical Minimum with a 2-byte value, fed up to its first value byte
+  const std::uint8_t item[] = {0x16, 0x01, 0xF8};
+  parser.feed(item, 2);
+  TEST_ASSERT_FALSE(parser.isAtItemBoundary());
+  parser.feed(item + 2, 1);
+  TEST_ASSERT_TRUE(parser.isAtItemBoundary());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_whole_buffer_finds_all_reports);
+  RUN_TEST(test_fixed_chunks_equal_whole_buffer);
+  RUN_TEST(test_uneven_chunks_equal_whole_buffer);
+  RUN_TEST(test_item_boundary_within_item);
+  return UNITY_END();
+}
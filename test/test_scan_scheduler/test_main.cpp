@@ -0,0 +1,137 @@
+#include <fmt/core.h>
+#include <unity.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "scan_scheduler.hpp"
+
+static constexpr std::int64_t SECOND_MICROS = 1000000;
+
+// Input of the scan task at a point in time. isReset marks a boot or a bonded device disconnecting.
+class TimelineEvent {
+ public:
+  std::int64_t timeMicros;
+  bool isPairing;
+  int connectedBondedCount;
+  bool isReset;
+};
+
+// Drives the scheduler the way taskScan does: re-evaluated on every event and at every getNextChangeMicros, with a bonded
+// count of 2. Returns the parameter changes as "seconds:interval/window" or "seconds:off".
+static std::vector<std::string> runTimeline(const std::vector<TimelineEvent>& events, std::int64_t endMicros) {
+  constexpr int BONDED_COUNT = 2;
+  ScanScheduler scheduler;
+  std::vector<std::string> timeline;
+  ScanParams lastParams;
+  lastParams.intervalMillis = 0xFFFF;  // Never equal to a real state, so the first evaluation is recorded
+  auto record = [&](std::int64_t nowMicros, const TimelineEvent& state) {
+    auto params = scheduler.getParams(state.isPairing, BONDED_COUNT, state.connectedBondedCount, nowMicros);
+    if (params == lastParams) {
+      return;
+    }
+    lastParams = params;
+    auto time = nowMicros / SECOND_MICROS;
+    timeline.push_back(params.isEnabled ? fmt::format("{}:{}/{}", time, params.intervalMillis, params.windowMillis)
+                                        : fmt::format("{}:off", time));
+  };
+  for (std::size_t i = 0; i < events.size(); i++) {
+    const auto& state = events[i];
+    if (state.isReset) {
+      scheduler.reset(state.timeMicros);
+    }
+    record(state.timeMicros, state);
+    auto untilMicros = i + 1 < events.size() ? events[i + 1].timeMicros : endMicros;
+    auto nowMicros = state.timeMicros;
+    while (true) {
+      nowMicros = scheduler.getNextChangeMicros(state.isPairing, BONDED_COUNT, state.connectedBondedCount, nowMicros);
+      if (nowMicros < 0 || nowMicros >= untilMicros) {
+        break;
+      }
+      record(nowMicros, state);
+    }
+  }
+  return timeline;
+}
+
+static void assertTimeline(const std::vector<std::string>& expected, const std::vector<std::string>& actual) {
+  TEST_ASSERT_EQUAL(expected.size(), actual.size());
+  for (std::size_t i = 0; i < expected.size(); i++) {
+    TEST_ASSERT_EQUAL_STRING(expected[i].c_str(), actual[i].c_str());
+  }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_backs_off_after_boot() {
+  auto timeline = runTimeline({{0, false, 0, true}}, 600 * SECOND_MICROS);
+
+  assertTimeline({"0:40/20", "10:100/15", "60:640/12"}, timeline);
+}
+
+void test_stops_when_all_bonded_devices_are_connected() {
+  auto timeline = runTimeline(
+      {
+          {0, false, 0, true},
+          {3 * SECOND_MICROS, false, 1, false},
+          {20 * SECOND_MICROS, false, 2, false},
+      },
+      600 * SECOND_MICROS);
+
+  // The first connection skips the aggressive step, the second stops scanning.
+  assertTimeline({"0:40/20", "3:100/15", "20:off"}, timeline);
+}
+
+void test_disconnect_restarts_back_off() {
+  auto timeline = runTimeline(
+      {
+          {0, false, 2, true},
+          {120 * SECOND_MICROS, false, 1, true},
+          {125 * SECOND_MICROS, false, 0, true},
+      },
+      600 * SECOND_MICROS);
+
+  // With one link still up the aggressive step is skipped; losing the last one restarts from it.
+  assertTimeline({"0:off", "120:100/15", "125:40/20", "135:100/15", "185:640/12"}, timeline);
+}
+
+void test_pairing_scans_aggressively() {
+  auto timeline = runTimeline(
+      {
+          {0, false, 2, true},
+          {30 * SECOND_MICROS, true, 2, false},
+          {90 * SECOND_MICROS, false, 2, false},
+      },
+      600 * SECOND_MICROS);
+
+  assertTimeline({"0:off", "30:40/20", "90:off"}, timeline);
+}
+
+// Radio time taken by scanning in the first ten minutes after boot with no device coming back.
+void test_radio_duty_after_boot() {
+  ScanScheduler scheduler;
+  scheduler.reset(0);
+  std::int64_t scanMicros = 0;
+  constexpr std::int64_t STEP_MICROS = 10000;
+  for (std::int64_t nowMicros = 0; nowMicros < 600 * SECOND_MICROS; nowMicros += STEP_MICROS) {
+    auto params = scheduler.getParams(false, 2, 0, nowMicros);
+    scanMicros += STEP_MICROS * params.windowMillis / params.intervalMillis;
+  }
+  auto dutyPermille = scanMicros * 1000 / (600 * SECOND_MICROS);
+  TEST_MESSAGE(fmt::format("Scan duty over 10 min after boot: {}.{}%", dutyPermille / 10, dutyPermille % 10).c_str());
+
+  TEST_ASSERT_LESS_OR_EQUAL(50, dutyPermille);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_backs_off_after_boot);
+  RUN_TEST(test_stops_when_all_bonded_devices_are_connected);
+  RUN_TEST(test_disconnect_restarts_back_off);
+  RUN_TEST(test_pairing_scans_aggressively);
+  RUN_TEST(test_radio_duty_after_boot);
+  return UNITY_END();
+}